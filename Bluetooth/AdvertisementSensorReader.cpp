@@ -0,0 +1,129 @@
+/*
+ * AdvertisementSensorReader.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "AdvertisementSensorReader.h"
+
+//sequence byte
+#define SENSOR_HEADER_SIZE  1
+//type and int16 value
+#define SENSOR_RECORD_SIZE  3
+
+ManufacturerSensorDecoder::ManufacturerSensorDecoder(uint16_t companyId)
+: companyId(companyId) {
+}
+
+int ManufacturerSensorDecoder::decode(const AdvertisingData& data, SensorReading& outReading) {
+    if (data.hasManufacturerData == false || data.companyId != companyId) {
+        return 0;
+    }
+    const AdBytes& payload = data.manufacturerData;
+    if (payload.length < SENSOR_HEADER_SIZE ||
+            (payload.length - SENSOR_HEADER_SIZE) % SENSOR_RECORD_SIZE != 0 ||
+            (payload.length - SENSOR_HEADER_SIZE) / SENSOR_RECORD_SIZE > SENSOR_MAX_VALUES) {
+        return -1;
+    }
+
+    outReading.sequence = payload.data[0];
+    outReading.valueCount = 0;
+    for (size_t position = SENSOR_HEADER_SIZE; position < payload.length; position += SENSOR_RECORD_SIZE) {
+        SensorValue& value = outReading.values[outReading.valueCount++];
+        value.type = payload.data[position];
+        value.raw = (int16_t) (payload.data[position + 1] | (payload.data[position + 2] << 8));
+        switch (value.type) {
+            case svtTemperature:
+            case svtHumidity:
+                value.value = value.raw / 100.0f;
+                break;
+
+            default:
+                value.value = value.raw;
+                break;
+        }
+    }
+    return 1;
+}
+
+AdvertisementSensorReader::AdvertisementSensorReader(SensorReadingListener& listener,
+        SensorAdvertisementDecoder* decoder, HciWrapperListener* forward)
+: listener(listener),
+  decoder(decoder != nullptr ? decoder : new ManufacturerSensorDecoder()),
+  ownsDecoder(decoder == nullptr),
+  forward(forward),
+  stats{0, 0, 0, 0} {
+}
+
+AdvertisementSensorReader::~AdvertisementSensorReader() {
+    if (ownsDecoder == true) {
+        delete decoder;
+    }
+}
+
+void AdvertisementSensorReader::onScanStart() {
+    if (forward != nullptr) {
+        forward->onScanStart();
+    }
+}
+
+void AdvertisementSensorReader::onScanStop() {
+    if (forward != nullptr) {
+        forward->onScanStop();
+    }
+}
+
+void AdvertisementSensorReader::onNewDeviceFound(const BTLEDevice& device) {
+    if (forward != nullptr) {
+        forward->onNewDeviceFound(device);
+    }
+}
+
+void AdvertisementSensorReader::onAdvertisingData(const BTLEDevice& device, const AdvertisingData& data) {
+    if (forward != nullptr) {
+        forward->onAdvertisingData(device, data);
+    }
+
+    SensorReading reading;
+    int result = decoder->decode(data, reading);
+    if (result == 0) {
+        return;
+    }
+
+    bool duplicate = false;
+    {
+        std::lock_guard<std::mutex> guard(statsMutex);
+        stats.reports++;
+        if (result < 0) {
+            stats.malformed++;
+            return;
+        }
+        //sensor repeats the same frame until next measurement
+        auto it = lastSequences.find(device.key);
+        duplicate = it != lastSequences.end() && it->second == reading.sequence;
+        if (duplicate == true) {
+            stats.duplicates++;
+        } else {
+            lastSequences[device.key] = reading.sequence;
+            stats.readings++;
+        }
+    }
+    if (duplicate == true) {
+        return;
+    }
+
+    reading.rssi = data.rssi;
+    reading.timestamp = device.lastSeen;
+    listener.onSensorReading(device, reading);
+}
+
+void AdvertisementSensorReader::resetSequences() {
+    std::lock_guard<std::mutex> guard(statsMutex);
+    lastSequences.clear();
+}
+
+SensorReaderStats AdvertisementSensorReader::getStats() {
+    std::lock_guard<std::mutex> guard(statsMutex);
+    return stats;
+}
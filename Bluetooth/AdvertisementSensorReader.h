@@ -0,0 +1,98 @@
+/*
+ * AdvertisementSensorReader.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef AdvertisementSensorReader_hpp
+#define AdvertisementSensorReader_hpp
+
+#include <stdint.h>
+#include <mutex>
+#include <unordered_map>
+#include "HciWrapper.hpp"
+
+enum SensorValueType {
+    svtTemperature = 1,     //0.01 C
+    svtHumidity = 2,        //0.01 %
+    svtBattery = 3          //mV
+};
+
+struct SensorValue {
+    uint8_t type;
+    int16_t raw;
+    float value;            //scaled by type, raw for unknown types
+};
+
+#define SENSOR_MAX_VALUES 6
+
+struct SensorReading {
+    uint8_t sequence;       //incremented by sensor with each new measurement
+    int8_t rssi;
+    int64_t timestamp;      //monotonic time of report, ms
+    int valueCount;
+    SensorValue values[SENSOR_MAX_VALUES];
+};
+
+struct SensorReaderStats {
+    uint64_t reports;       //reports recognized as sensor data
+    uint64_t readings;      //published
+    uint64_t duplicates;    //same sequence as last published reading of device
+    uint64_t malformed;
+};
+
+class SensorReadingListener {
+    public:
+        virtual ~SensorReadingListener() = default;
+        //called on scan thread, must not block
+        virtual void onSensorReading(const BTLEDevice& device, const SensorReading& reading) = 0;
+};
+
+//Recognizes sensor frame in advertisement. Result: 1 - decoded, 0 - not a sensor frame, -1 - malformed
+class SensorAdvertisementDecoder {
+    public:
+        virtual ~SensorAdvertisementDecoder() = default;
+        virtual int decode(const AdvertisingData& data, SensorReading& outReading) = 0;
+};
+
+//PLACEHOLDER format, no shipped sensor firmware uses it yet: manufacturer specific data with company
+//id 0xFFFF, sequence byte and (type, int16 LE) records. Real sensors need their own decoder passed
+//to AdvertisementSensorReader.
+class ManufacturerSensorDecoder : public SensorAdvertisementDecoder {
+    public:
+        //0xFFFF is company id reserved for internal use and testing, not for products
+        ManufacturerSensorDecoder(uint16_t companyId = 0xFFFF);
+        virtual int decode(const AdvertisingData& data, SensorReading& outReading) override;
+    private:
+        uint16_t companyId;
+};
+
+//Connectionless readout, it's used as listener of HciWrapper. Readings repeated by sensor in each
+//advertisement are published once, other HciWrapper events are passed to forward listener.
+class AdvertisementSensorReader : public HciWrapperListener {
+    public:
+        AdvertisementSensorReader(SensorReadingListener& listener, SensorAdvertisementDecoder* decoder = nullptr,
+                HciWrapperListener* forward = nullptr);
+        virtual ~AdvertisementSensorReader();
+
+        virtual void onScanStart() override;
+        virtual void onScanStop() override;
+        virtual void onNewDeviceFound(const BTLEDevice& device) override;
+        virtual void onAdvertisingData(const BTLEDevice& device, const AdvertisingData& data) override;
+
+        //next reading of each device is published even if sequence didn't change
+        void resetSequences();
+        SensorReaderStats getStats();
+
+    private:
+        SensorReadingListener& listener;
+        SensorAdvertisementDecoder* decoder;
+        bool ownsDecoder;
+        HciWrapperListener* forward;
+        std::mutex statsMutex;
+        std::unordered_map<uint64_t, uint8_t> lastSequences;   //guarded by statsMutex
+        SensorReaderStats stats;
+};
+
+#endif /* AdvertisementSensorReader_hpp */
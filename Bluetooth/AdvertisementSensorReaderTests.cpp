@@ -0,0 +1,142 @@
+/*
+ * AdvertisementSensorReaderTests.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "AdvertisementSensorReaderTests.hpp"
+#include "AdvertisementSensorReader.h"
+#include <vector>
+
+//decoded fields point into payload, so it's kept until next frame()
+static std::vector<uint8_t> framePayload;
+
+//advertising data with manufacturer specific structure of given company and payload
+static AdvertisingData frame(uint16_t companyId, const std::vector<uint8_t>& payload) {
+  framePayload = {(uint8_t) (payload.size() + 3), 0xFF, (uint8_t) companyId, (uint8_t) (companyId >> 8)};
+  framePayload.insert(framePayload.end(), payload.begin(), payload.end());
+  AdvertisingData data;
+  decodeAdvertisingData(framePayload.data(), framePayload.size(), data);
+  data.eventType = 0;
+  data.rssi = -60;
+  return data;
+}
+
+static bool testDecoder() {
+  bool testResult = true;
+  ManufacturerSensorDecoder decoder;
+  SensorReading reading;
+
+  //temperature 23.45 C, humidity 50.5 %, battery 3000 mV
+  testResult &= decoder.decode(frame(0xFFFF, {7, 1, 0x29, 0x09, 2, 0xBA, 0x13, 3, 0xB8, 0x0B}), reading) == 1;
+  testResult &= reading.sequence == 7;
+  testResult &= reading.valueCount == 3;
+  testResult &= reading.values[0].type == svtTemperature && reading.values[0].raw == 2345;
+  testResult &= reading.values[0].value > 23.449f && reading.values[0].value < 23.451f;
+  testResult &= reading.values[1].type == svtHumidity && reading.values[1].raw == 5050;
+  testResult &= reading.values[2].type == svtBattery && reading.values[2].value == 3000.0f;
+
+  //negative value, unknown type is not scaled
+  testResult &= decoder.decode(frame(0xFFFF, {8, 1, 0x38, 0xFF, 9, 0x38, 0xFF}), reading) == 1;
+  testResult &= reading.values[0].raw == -200 && reading.values[0].value == -2.0f;
+  testResult &= reading.values[1].value == -200.0f;
+
+  //sequence only
+  testResult &= decoder.decode(frame(0xFFFF, {9}), reading) == 1;
+  testResult &= reading.valueCount == 0;
+  return testResult;
+}
+
+static bool testDecoderRejects() {
+  bool testResult = true;
+  ManufacturerSensorDecoder decoder;
+  SensorReading reading;
+
+  //not a sensor frame
+  testResult &= decoder.decode(frame(0x004C, {7, 1, 0x29, 0x09}), reading) == 0;
+  AdvertisingData empty;
+  decodeAdvertisingData(nullptr, 0, empty);
+  testResult &= decoder.decode(empty, reading) == 0;
+  ManufacturerSensorDecoder otherCompany(0x1234);
+  testResult &= otherCompany.decode(frame(0xFFFF, {7}), reading) == 0;
+  testResult &= otherCompany.decode(frame(0x1234, {7}), reading) == 1;
+
+  //malformed
+  testResult &= decoder.decode(frame(0xFFFF, {}), reading) == -1;
+  testResult &= decoder.decode(frame(0xFFFF, {7, 1, 0x29}), reading) == -1;
+  std::vector<uint8_t> tooMany = {7};
+  for (int i = 0; i < SENSOR_MAX_VALUES + 1; i++) {
+    tooMany.insert(tooMany.end(), {1, 0, 0});
+  }
+  testResult &= decoder.decode(frame(0xFFFF, tooMany), reading) == -1;
+  return testResult;
+}
+
+class CountingListener : public SensorReadingListener {
+  public:
+    int readings = 0;
+    uint8_t lastSequence = 0;
+    int8_t lastRssi = 0;
+
+    virtual void onSensorReading(const BTLEDevice& device, const SensorReading& reading) override {
+      readings++;
+      lastSequence = reading.sequence;
+      lastRssi = reading.rssi;
+    }
+};
+
+static BTLEDevice device(uint64_t key) {
+  BTLEDevice result("", "");
+  result.key = key;
+  return result;
+}
+
+static bool testSequenceDedup() {
+  bool testResult = true;
+  CountingListener listener;
+  AdvertisementSensorReader reader(listener);
+  BTLEDevice first = device(1);
+  BTLEDevice second = device(2);
+
+  //sensor repeats frame until next measurement
+  reader.onAdvertisingData(first, frame(0xFFFF, {5, 1, 0x29, 0x09}));
+  reader.onAdvertisingData(first, frame(0xFFFF, {5, 1, 0x29, 0x09}));
+  testResult &= listener.readings == 1;
+  testResult &= listener.lastSequence == 5;
+  testResult &= listener.lastRssi == -60;
+
+  //sequences are per device
+  reader.onAdvertisingData(second, frame(0xFFFF, {5, 1, 0x29, 0x09}));
+  testResult &= listener.readings == 2;
+
+  //any change is new reading, wrap around too
+  reader.onAdvertisingData(first, frame(0xFFFF, {6}));
+  reader.onAdvertisingData(first, frame(0xFFFF, {5}));
+  testResult &= listener.readings == 4;
+
+  reader.resetSequences();
+  reader.onAdvertisingData(first, frame(0xFFFF, {5}));
+  testResult &= listener.readings == 5;
+
+  //malformed frame doesn't change last sequence, other frames are not counted
+  reader.onAdvertisingData(first, frame(0xFFFF, {6, 1}));
+  reader.onAdvertisingData(first, frame(0x004C, {6}));
+  reader.onAdvertisingData(first, frame(0xFFFF, {5}));
+  testResult &= listener.readings == 5;
+
+  SensorReaderStats stats = reader.getStats();
+  testResult &= stats.reports == 8;
+  testResult &= stats.readings == 5;
+  testResult &= stats.duplicates == 2;
+  testResult &= stats.malformed == 1;
+  return testResult;
+}
+
+bool testAdvertisementSensorReader() {
+  bool testResult = true;
+  testResult &= testDecoder();
+  testResult &= testDecoderRejects();
+  testResult &= testSequenceDedup();
+  return testResult;
+}
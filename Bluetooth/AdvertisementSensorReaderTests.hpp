@@ -0,0 +1,13 @@
+/*
+ * AdvertisementSensorReaderTests.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef AdvertisementSensorReaderTests_hpp
+#define AdvertisementSensorReaderTests_hpp
+
+bool testAdvertisementSensorReader();
+
+#endif /* AdvertisementSensorReaderTests_hpp */
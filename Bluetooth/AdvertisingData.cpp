@@ -0,0 +1,155 @@
+/*
+ * AdvertisingData.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "AdvertisingData.h"
+
+AdStructureIterator::AdStructureIterator(const uint8_t* payload, size_t length)
+: payload(payload), length(length), position(0), malformed(false) {
+}
+
+bool AdStructureIterator::next(AdStructure& outStructure) {
+    while (position < length) {
+        size_t structureLength = payload[position];
+        if (structureLength == 0) {
+            //early termination, rest is padding
+            position = length;
+            return false;
+        }
+        if (position + 1 + structureLength > length) {
+            malformed = true;
+            position = length;
+            return false;
+        }
+        outStructure.type = payload[position + 1];
+        outStructure.value.data = payload + position + 2;
+        outStructure.value.length = structureLength - 1;
+        position += 1 + structureLength;
+        return true;
+    }
+    return false;
+}
+
+bool AdStructureIterator::isMalformed() const {
+    return malformed;
+}
+
+static uint16_t readU16(const uint8_t* data) {
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+size_t AdvertisingData::getUuid16Count() const {
+    return uuids16.length / 2;
+}
+
+uint16_t AdvertisingData::getUuid16(size_t index) const {
+    return readU16(uuids16.data + index * 2);
+}
+
+const AdServiceData* AdvertisingData::findServiceData(uint16_t uuid16) const {
+    for (int i = 0; i < serviceDataCount; i++) {
+        if (serviceData[i].uuidSize == 2 && readU16(serviceData[i].uuid) == uuid16) {
+            return &serviceData[i];
+        }
+    }
+    return nullptr;
+}
+
+static void addServiceData(AdvertisingData& out, const AdStructure& structure, uint8_t uuidSize) {
+    if (structure.value.length < uuidSize || out.serviceDataCount >= AD_MAX_SERVICE_DATA) {
+        return;
+    }
+    AdServiceData& serviceData = out.serviceData[out.serviceDataCount++];
+    serviceData.uuidSize = uuidSize;
+    serviceData.uuid = structure.value.data;
+    serviceData.data.data = structure.value.data + uuidSize;
+    serviceData.data.length = structure.value.length - uuidSize;
+}
+
+bool decodeAdvertisingData(const uint8_t* payload, size_t length, AdvertisingData& out) {
+    out.flags = -1;
+    out.name = std::string_view();
+    out.completeName = false;
+    out.hasTxPower = false;
+    out.txPower = 0;
+    out.uuids16 = AdBytes{nullptr, 0};
+    out.uuids32 = AdBytes{nullptr, 0};
+    out.uuids128 = AdBytes{nullptr, 0};
+    out.hasManufacturerData = false;
+    out.companyId = 0;
+    out.manufacturerData = AdBytes{nullptr, 0};
+    out.serviceDataCount = 0;
+
+    AdStructureIterator iterator(payload, length);
+    AdStructure structure;
+    while (iterator.next(structure) == true) {
+        const AdBytes& value = structure.value;
+        switch (structure.type) {
+            case adFlags:
+                if (value.length >= 1) {
+                    out.flags = value.data[0];
+                }
+                break;
+
+            case adUuid16Incomplete:
+            case adUuid16Complete:
+                out.uuids16 = AdBytes{value.data, value.length - value.length % 2};
+                break;
+
+            case adUuid32Incomplete:
+            case adUuid32Complete:
+                out.uuids32 = AdBytes{value.data, value.length - value.length % 4};
+                break;
+
+            case adUuid128Incomplete:
+            case adUuid128Complete:
+                out.uuids128 = AdBytes{value.data, value.length - value.length % 16};
+                break;
+
+            case adNameShort:
+            case adNameComplete:
+                //complete name wins over short one
+                if (out.completeName == false) {
+                    out.name = std::string_view((const char*) value.data, value.length);
+                    out.completeName = structure.type == adNameComplete;
+                }
+                break;
+
+            case adTxPower:
+                if (value.length >= 1) {
+                    out.hasTxPower = true;
+                    out.txPower = (int8_t) value.data[0];
+                }
+                break;
+
+            case adServiceData16:
+                addServiceData(out, structure, 2);
+                break;
+
+            case adServiceData32:
+                addServiceData(out, structure, 4);
+                break;
+
+            case adServiceData128:
+                addServiceData(out, structure, 16);
+                break;
+
+            case adManufacturerSpecific:
+                if (value.length >= 2) {
+                    out.hasManufacturerData = true;
+                    out.companyId = readU16(value.data);
+                    out.manufacturerData = AdBytes{value.data + 2, value.length - 2};
+                }
+                break;
+
+            default:
+                //not interesting
+                break;
+        }
+    }
+    out.malformed = iterator.isMalformed();
+    return out.malformed == false;
+}
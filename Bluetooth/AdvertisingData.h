@@ -0,0 +1,93 @@
+/*
+ * AdvertisingData.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef AdvertisingData_hpp
+#define AdvertisingData_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+//AD types from Bluetooth assigned numbers
+enum AdType {
+    adFlags                 = 0x01,
+    adUuid16Incomplete      = 0x02,
+    adUuid16Complete        = 0x03,
+    adUuid32Incomplete      = 0x04,
+    adUuid32Complete        = 0x05,
+    adUuid128Incomplete     = 0x06,
+    adUuid128Complete       = 0x07,
+    adNameShort             = 0x08,
+    adNameComplete          = 0x09,
+    adTxPower               = 0x0A,
+    adServiceData16         = 0x16,
+    adServiceData32         = 0x20,
+    adServiceData128        = 0x21,
+    adManufacturerSpecific  = 0xFF
+};
+
+//View into advertising report, valid only while report buffer is
+struct AdBytes {
+    const uint8_t* data;
+    size_t length;
+};
+
+struct AdStructure {
+    uint8_t type;
+    AdBytes value;      //without length and type
+};
+
+//Walks length-type-value structures of advertising payload without copying
+class AdStructureIterator {
+    public:
+        AdStructureIterator(const uint8_t* payload, size_t length);
+        //false at the end or at malformed structure
+        bool next(AdStructure& outStructure);
+        bool isMalformed() const;
+    private:
+        const uint8_t* payload;
+        size_t length;
+        size_t position;
+        bool malformed;
+};
+
+struct AdServiceData {
+    uint8_t uuidSize;       //2, 4 or 16 bytes
+    const uint8_t* uuid;    //little endian, as in report
+    AdBytes data;
+};
+
+#define AD_MAX_SERVICE_DATA 4
+
+//Decoded payload of one advertising report, all fields point into report buffer
+struct AdvertisingData {
+    uint8_t eventType;
+    int8_t rssi;
+    int flags;                  //-1 when not present
+    std::string_view name;
+    bool completeName;
+    bool hasTxPower;
+    int8_t txPower;
+    AdBytes uuids16;            //packed little endian UUIDs, complete or incomplete list
+    AdBytes uuids32;
+    AdBytes uuids128;
+    bool hasManufacturerData;
+    uint16_t companyId;
+    AdBytes manufacturerData;   //without company id
+    int serviceDataCount;
+    AdServiceData serviceData[AD_MAX_SERVICE_DATA];
+    bool malformed;             //decoding stopped at broken structure, fields before it are valid
+
+    size_t getUuid16Count() const;
+    uint16_t getUuid16(size_t index) const;
+    const AdServiceData* findServiceData(uint16_t uuid16) const;
+};
+
+//false when payload is malformed, out is filled with everything before broken structure
+bool decodeAdvertisingData(const uint8_t* payload, size_t length, AdvertisingData& out);
+
+#endif /* AdvertisingData_hpp */
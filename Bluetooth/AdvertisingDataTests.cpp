@@ -0,0 +1,168 @@
+/*
+ * AdvertisingDataTests.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "AdvertisingDataTests.hpp"
+#include "AdvertisingData.h"
+#include <vector>
+
+struct IteratorCase {
+  std::vector<uint8_t> payload;
+  int structures;     //returned by iterator before it stops
+  bool malformed;
+};
+
+static bool testIterator() {
+  bool testResult = true;
+  const IteratorCase cases[] = {
+    //empty payload
+    {{}, 0, false},
+    //structure ends exactly at end of payload
+    {{0x02, 0x01, 0x06, 0x03, 0x09, 'A', 'B'}, 2, false},
+    //zero length terminates, rest is padding even if it looks like structure
+    {{0x02, 0x01, 0x06, 0x00, 0x03, 0x09, 'A', 'B'}, 1, false},
+    {{0x00, 0x00, 0x00}, 0, false},
+    //length goes one byte past end of payload
+    {{0x02, 0x01, 0x06, 0x04, 0x09, 'A', 'B'}, 1, true},
+    //length byte is last byte of payload
+    {{0x02, 0x01, 0x06, 0x02}, 1, true},
+    //type without value
+    {{0x01, 0x09}, 1, false},
+  };
+
+  for (const IteratorCase& testCase : cases) {
+    AdStructureIterator iterator(testCase.payload.data(), testCase.payload.size());
+    AdStructure structure;
+    int structures = 0;
+    while (iterator.next(structure) == true) {
+      //value never reaches past payload
+      testResult &= structure.value.data + structure.value.length <=
+          testCase.payload.data() + testCase.payload.size();
+      structures++;
+    }
+    testResult &= structures == testCase.structures;
+    testResult &= iterator.isMalformed() == testCase.malformed;
+    //iterator stays at end
+    testResult &= iterator.next(structure) == false;
+  }
+  return testResult;
+}
+
+//decoded fields point into payload, so it's kept until next decode()
+static std::vector<uint8_t> decodedPayload;
+
+static bool decode(const std::vector<uint8_t>& payload, AdvertisingData& out) {
+  decodedPayload = payload;
+  return decodeAdvertisingData(decodedPayload.data(), decodedPayload.size(), out);
+}
+
+static bool testTruncated() {
+  bool testResult = true;
+  AdvertisingData data;
+
+  //fields before broken structure are kept
+  testResult &= decode({0x02, 0x01, 0x06, 0x05, 0x09, 'A', 'B'}, data) == false;
+  testResult &= data.malformed == true;
+  testResult &= data.flags == 0x06;
+  testResult &= data.name.empty() == true;
+
+  testResult &= decode({0x02, 0x01, 0x06, 0x00, 0x03, 0x09, 'A', 'B'}, data) == true;
+  testResult &= data.malformed == false;
+  testResult &= data.name.empty() == true;
+  return testResult;
+}
+
+static bool testUuidLists() {
+  bool testResult = true;
+  AdvertisingData data;
+
+  //odd trailing bytes of UUID lists are ignored
+  testResult &= decode({0x04, 0x03, 0x0F, 0x18, 0x0A}, data) == true;
+  testResult &= data.uuids16.length == 2;
+  testResult &= data.getUuid16Count() == 1;
+  testResult &= data.getUuid16(0) == 0x180F;
+
+  testResult &= decode({0x02, 0x02, 0x0F}, data) == true;
+  testResult &= data.getUuid16Count() == 0;
+
+  testResult &= decode({0x07, 0x05, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06}, data) == true;
+  testResult &= data.uuids32.length == 4;
+
+  std::vector<uint8_t> payload = {0x12, 0x07};
+  payload.resize(payload.size() + 17, 0xAA);
+  testResult &= decode(payload, data) == true;
+  testResult &= data.uuids128.length == 16;
+  return testResult;
+}
+
+static bool testServiceData() {
+  bool testResult = true;
+  AdvertisingData data;
+
+  //shorter than its UUID, skipped
+  testResult &= decode({0x02, 0x16, 0x0F}, data) == true;
+  testResult &= data.serviceDataCount == 0;
+  testResult &= decode({0x04, 0x20, 0x01, 0x02, 0x03}, data) == true;
+  testResult &= data.serviceDataCount == 0;
+
+  //UUID only, empty data
+  testResult &= decode({0x03, 0x16, 0x0F, 0x18}, data) == true;
+  testResult &= data.serviceDataCount == 1;
+  testResult &= data.findServiceData(0x180F) != nullptr;
+  testResult &= data.findServiceData(0x180F)->data.length == 0;
+
+  testResult &= decode({0x04, 0x16, 0x0F, 0x18, 0x64}, data) == true;
+  testResult &= data.findServiceData(0x180F)->data.length == 1;
+  testResult &= data.findServiceData(0x180F)->data.data[0] == 0x64;
+  testResult &= data.findServiceData(0x180A) == nullptr;
+  return testResult;
+}
+
+static bool testManufacturerData() {
+  bool testResult = true;
+  AdvertisingData data;
+
+  //company id needs 2 bytes
+  testResult &= decode({0x02, 0xFF, 0x4C}, data) == true;
+  testResult &= data.hasManufacturerData == false;
+  testResult &= decode({0x01, 0xFF}, data) == true;
+  testResult &= data.hasManufacturerData == false;
+
+  //company id only
+  testResult &= decode({0x03, 0xFF, 0x4C, 0x00}, data) == true;
+  testResult &= data.hasManufacturerData == true;
+  testResult &= data.companyId == 0x004C;
+  testResult &= data.manufacturerData.length == 0;
+  return testResult;
+}
+
+static bool testName() {
+  bool testResult = true;
+  AdvertisingData data;
+
+  //complete name wins regardless of order
+  testResult &= decode({0x03, 0x09, 'A', 'B', 0x02, 0x08, 'A'}, data) == true;
+  testResult &= data.name == "AB";
+  testResult &= data.completeName == true;
+  testResult &= decode({0x02, 0x08, 'A', 0x03, 0x09, 'A', 'B'}, data) == true;
+  testResult &= data.name == "AB";
+
+  testResult &= decode({0x02, 0x0A, 0xF4}, data) == true;
+  testResult &= data.hasTxPower == true;
+  testResult &= data.txPower == -12;
+  return testResult;
+}
+
+bool testAdvertisingData() {
+  bool testResult = true;
+  testResult &= testIterator();
+  testResult &= testTruncated();
+  testResult &= testUuidLists();
+  testResult &= testServiceData();
+  testResult &= testManufacturerData();
+  testResult &= testName();
+  return testResult;
+}
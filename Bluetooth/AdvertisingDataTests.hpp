@@ -0,0 +1,13 @@
+/*
+ * AdvertisingDataTests.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef AdvertisingDataTests_hpp
+#define AdvertisingDataTests_hpp
+
+bool testAdvertisingData();
+
+#endif /* AdvertisingDataTests_hpp */
@@ -5,37 +5,145 @@
  *      Author: Zarnowski
  */
 
-#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
 #include "BluetoothGuard.h"
 
+//most of BlueZ controllers handle at least this number of LE links
+static const int DEFAULT_MAX_LINKS = 4;
+
 std::mutex BluetoothGuard::innerMutex;
+std::condition_variable BluetoothGuard::innerCondition;
 void* BluetoothGuard::owner = nullptr;
+void* BluetoothGuard::connectOwner = nullptr;
+void* BluetoothGuard::scanOwner = nullptr;
+std::set<void*> BluetoothGuard::linkOwners;
+int BluetoothGuard::maxLinks = DEFAULT_MAX_LINKS;
+
+template<typename Predicate>
+bool BluetoothGuard::waitFor(std::unique_lock<std::mutex>& lock, int timeoutInMs, Predicate predicate) {
+  if (timeoutInMs < 0) {
+    innerCondition.wait(lock, predicate);
+    return true;
+  }
+  return innerCondition.wait_for(lock, std::chrono::milliseconds(timeoutInMs), predicate);
+}
+
+void BluetoothGuard::checkOwner(void* expected, void* owner) {
+  if (owner != expected) {
+    printf("Wrong owner of bluetooth guard, expected %p but got %p", expected, owner);
+    exit(-1); //this is fatal
+  }
+}
 
 void BluetoothGuard::lockBluetooth(void* owner) {
-  while(true) {
-    //critical section
+  std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+  waitFor(lock, -1, []() {
+    return BluetoothGuard::owner == nullptr && connectOwner == nullptr && scanOwner == nullptr && linkOwners.empty();
+  });
+  BluetoothGuard::owner = owner;
+}
+
+void BluetoothGuard::unlockBluetooth(void* owner) {
+  {
     std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
-    if (BluetoothGuard::owner != nullptr) {
-      lock.unlock();
-      usleep(50 * 1000);
+    checkOwner(BluetoothGuard::owner, owner);
+    BluetoothGuard::owner = nullptr;
+  }
+  innerCondition.notify_all();
+}
+
+bool BluetoothGuard::tryLockBluetooth(void* owner) {
+  std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+  if (BluetoothGuard::owner != nullptr || (connectOwner != nullptr && connectOwner != owner) ||
+      scanOwner != nullptr || linkOwners.size() > linkOwners.count(owner)) {
+    return false;
+  }
+  BluetoothGuard::owner = owner;
+  return true;
+}
+
+bool BluetoothGuard::isBluetoothLocked(void* owner) {
+  std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+  return owner == nullptr ? BluetoothGuard::owner != nullptr : BluetoothGuard::owner == owner;
+}
 
-    } else {
-      BluetoothGuard::owner = owner;
+void BluetoothGuard::setMaxLinks(int maxLinks) {
+  {
+    std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+    BluetoothGuard::maxLinks = maxLinks < 1 ? 1 : maxLinks;
+  }
+  //more slots could become free
+  innerCondition.notify_all();
+}
+
+int BluetoothGuard::getMaxLinks() {
+  std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+  return maxLinks;
+}
+
+bool BluetoothGuard::acquireLink(void* owner, int timeoutInMs) {
+  std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+  if (linkOwners.count(owner) != 0) {
+    return true;
+  }
+  if (waitFor(lock, timeoutInMs, []() {
+    return BluetoothGuard::owner == nullptr && (int) linkOwners.size() < maxLinks;
+  }) == false) {
+    return false;
+  }
+  linkOwners.insert(owner);
+  return true;
+}
+
+void BluetoothGuard::releaseLink(void* owner) {
+  {
+    std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+    //disconnect() can be called more times, so missing slot is not an error
+    if (linkOwners.erase(owner) == 0) {
       return;
     }
   }
+  innerCondition.notify_all();
 }
 
-void BluetoothGuard::unlockBluetooth(void* owner) {
+bool BluetoothGuard::beginConnect(void* owner, int timeoutInMs) {
   std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
-  if (owner != BluetoothGuard::owner) {
-    printf("Wrong owner of bluetooth guard, expected %p but got %p", BluetoothGuard::owner, owner);
-    exit(-1); //this is fatal
+  if (waitFor(lock, timeoutInMs, []() {
+    return BluetoothGuard::owner == nullptr && connectOwner == nullptr && scanOwner == nullptr;
+  }) == false) {
+    return false;
   }
-  BluetoothGuard::owner = nullptr;
+  connectOwner = owner;
+  return true;
 }
 
-bool BluetoothGuard::isBluetoothLocked(void* owner) {
+void BluetoothGuard::endConnect(void* owner) {
+  {
+    std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+    checkOwner(connectOwner, owner);
+    connectOwner = nullptr;
+  }
+  innerCondition.notify_all();
+}
+
+bool BluetoothGuard::beginScan(void* owner, int timeoutInMs) {
   std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
-  return owner == nullptr ? BluetoothGuard::owner != nullptr : BluetoothGuard::owner == owner;
+  if (waitFor(lock, timeoutInMs, []() {
+    return BluetoothGuard::owner == nullptr && connectOwner == nullptr && scanOwner == nullptr;
+  }) == false) {
+    return false;
+  }
+  scanOwner = owner;
+  return true;
+}
+
+void BluetoothGuard::endScan(void* owner) {
+  {
+    std::unique_lock<std::mutex> lock(BluetoothGuard::innerMutex);
+    checkOwner(scanOwner, owner);
+    scanOwner = nullptr;
+  }
+  innerCondition.notify_all();
 }
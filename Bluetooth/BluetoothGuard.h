@@ -9,16 +9,47 @@
 #define BluetoothGuard_hpp
 
 #include <mutex>
+#include <condition_variable>
+#include <set>
 
+//Arbitration of single adapter. Any number of links (up to maxLinks) can be open at once, but only one
+//of them can be establishing connection and scanning can't run while connection is being created.
+//Timeouts are in ms, negative timeout waits forever. Methods return false on timeout.
 class BluetoothGuard {
   public:
+    //whole adapter, waits until all links, scans and connects are released
     static void lockBluetooth(void* owner);
     static void unlockBluetooth(void* owner);
     static bool isBluetoothLocked(void* owner = nullptr);
+    //doesn't wait, fails when others hold links, connect or scan. Owner's own link and connect are allowed.
+    static bool tryLockBluetooth(void* owner);
+
+    //max number of concurrent LE links, it's controller dependent
+    static void setMaxLinks(int maxLinks);
+    static int getMaxLinks();
+
+    //slot is held for whole connection lifetime, acquiring already owned slot succeeds
+    static bool acquireLink(void* owner, int timeoutInMs = -1);
+    static void releaseLink(void* owner);
+
+    //controller can create one connection at a time and not while scanning
+    static bool beginConnect(void* owner, int timeoutInMs = -1);
+    static void endConnect(void* owner);
+    static bool beginScan(void* owner, int timeoutInMs = -1);
+    static void endScan(void* owner);
 
   private:
     static std::mutex innerMutex;
+    static std::condition_variable innerCondition;  //signalled on each release
     static void* owner;
+    static void* connectOwner;
+    static void* scanOwner;
+    static std::set<void*> linkOwners;
+    static int maxLinks;
+
+    template<typename Predicate>
+    static bool waitFor(std::unique_lock<std::mutex>& lock, int timeoutInMs, Predicate predicate);
+    static void checkOwner(void* expected, void* owner);
 };
 
 #endif /* BluetoothGuard_hpp */
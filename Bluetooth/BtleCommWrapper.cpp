@@ -13,7 +13,11 @@
 #include <unistd.h>
 #include <string.h>
 #include <algorithm>
+#include <chrono>
 #include "BluetoothGuard.h"
+#include "BtleReactor.h"
+#include "GattHandleCache.h"
+#include "BtleRecovery.h"
 #include "HciWrapper.hpp"
 extern "C" {
   #include "libgatt/att.h"
@@ -22,11 +26,24 @@ extern "C" {
   #include "libgatt/gattrib.h"
 }
 #include "ReadSyncBlock.h"
+#include "../Parsers/CharScanner.h"
 
 //HM-10
 static const char* CHAR_UUID = "0000ffe1-0000-1000-8000-00805f9b34fb";
-
-static const char* THREAD_NAME = "BtleCom";
+//Service Changed value and its client configuration descriptor, both are kept in handle cache
+static const char* SERVICE_CHANGED_UUID = "00002a05-0000-1000-8000-00805f9b34fb";
+static const char* SERVICE_CHANGED_CONFIG_UUID = "00002902-0000-1000-8000-00805f9b34fb";
+
+static const size_t NOTIFICATION_BUFFER_SIZE = 4096;
+//max number of write commands one send() keeps queued in GAttrib. GAttrib doesn't expose its queue
+//depth, so it's counted by destroy notifies of our own chunks.
+static const int WRITE_COMMAND_CREDITS = 4;
+//opcode and handle
+static const size_t WRITE_COMMAND_HEADER_SIZE = 3;
+//max ATT MTU, peer answers with its own limit
+static const guint16 REQUESTED_MTU = 517;
+//time for which line can still be late response of expired request, new requests are held meanwhile
+static const gint64 LATE_RESPONSE_GRACE_MS = 1000;
 
 //This class is NOT owning any of fields
 class BtleCallbackData {
@@ -42,40 +59,157 @@ class BtleCallbackData {
     }
 };
 
-static gpointer threadMain(void *data) {
-  GMainLoop* loop = static_cast<GMainLoop*>(data);
-  printf("BTLE thread start\n");
-  g_main_loop_run(loop);
-  printf("BTLE thread loop end\n");
-  return nullptr;
+//Identifies pending request in GLib callbacks, request itself may be already completed. Sources and
+//commands holding it are dropped by disconnect() on event loop thread, so btleCom is valid in them.
+class RequestRef {
+  public:
+    BtleCommWrapper* btleCom;
+    guint64 id;
+    RequestRef(BtleCommWrapper* btleCom, guint64 id)
+    : btleCom(btleCom), id(id) {
+
+    }
+};
+
+static void deleteRequestRef(gpointer data) {
+  delete static_cast<RequestRef*>(data);
 }
 
-static bool isItEnter(int i) {
-  return i == 13;
+//Data of one send() in smWriteCommand mode. offset and inFlight are used only on event loop thread,
+//destroy notifies of queued chunks come there too, disconnect() drops GAttrib on that thread.
+class WriteCommandStream {
+  public:
+    BtleCommWrapper* btleCom;
+    string data;
+    size_t offset;
+    int inFlight;   //chunks queued in GAttrib, each one takes credit
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool finished;  //also set when send() gives up, then btleCom can't be used any more
+    bool failed;
+
+    WriteCommandStream(BtleCommWrapper* btleCom, const string& data)
+    : btleCom(btleCom), data(data), offset(0), inFlight(0), finished(false), failed(false) {
+
+    }
+
+    void finish(bool failed) {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (finished == false) {
+          finished = true;
+          this->failed = failed;
+        }
+      }
+      condition.notify_all();
+    }
+
+    bool isFinished() {
+      std::lock_guard<std::mutex> guard(mutex);
+      return finished;
+    }
+};
+
+//Keeps stream alive while it's referenced by GLib source or queued chunk
+class WriteCommandStreamRef {
+  public:
+    std::shared_ptr<WriteCommandStream> stream;
+    WriteCommandStreamRef(const std::shared_ptr<WriteCommandStream>& stream)
+    : stream(stream) {
+
+    }
+};
+
+static void deleteWriteCommandStreamRef(gpointer data) {
+  delete static_cast<WriteCommandStreamRef*>(data);
+}
+
+//Result of one send() in smWriteRequest mode, shared with GAttrib command until its destroy notify.
+//send() abandons it on timeout, then late response is just dropped and btleCom can't be used any more.
+class WriteRequestSync {
+  public:
+    GMutex mutex;
+    ReadSyncBlock block;
+    BtleCommWrapper* btleCom;
+    string data;
+    bool abandoned;
+
+    WriteRequestSync(BtleCommWrapper* btleCom, const string& data)
+    : block(&mutex), btleCom(btleCom), data(data), abandoned(false) {
+      g_mutex_init(&mutex);
+    }
+
+    ~WriteRequestSync() {
+      g_mutex_clear(&mutex);
+    }
+};
+
+class WriteRequestSyncRef {
+  public:
+    std::shared_ptr<WriteRequestSync> sync;
+    WriteRequestSyncRef(const std::shared_ptr<WriteRequestSync>& sync)
+    : sync(sync) {
+
+    }
+};
+
+static void deleteWriteRequestSyncRef(gpointer data) {
+  delete static_cast<WriteRequestSyncRef*>(data);
+}
+
+//Target of recovery timer. Timer can be already dispatched when wrapper cancels it, so the handler
+//checks btleCom under own mutex and cancelRecovery() waits for running handler.
+class RecoveryTimer {
+  public:
+    std::mutex mutex;
+    BtleCommWrapper* btleCom;   //nullptr when cancelled
+
+    RecoveryTimer(BtleCommWrapper* btleCom)
+    : btleCom(btleCom) {
+
+    }
+};
+
+class RecoveryTimerRef {
+  public:
+    std::shared_ptr<RecoveryTimer> timer;
+    RecoveryTimerRef(const std::shared_ptr<RecoveryTimer>& timer)
+    : timer(timer) {
+
+    }
+};
+
+static void deleteRecoveryTimerRef(gpointer data) {
+  delete static_cast<RecoveryTimerRef*>(data);
 }
 
 BtleCommWrapper::BtleCommWrapper()
 : state(cssNone),
-  eventLoop(g_main_loop_new(nullptr, false)),
-  eventLoopThread(g_thread_new(THREAD_NAME, &threadMain, eventLoop)),
   btleChannel(nullptr),
+  channelWatchSource(0),
   btleAttribute(nullptr),
   btleValueHandle(0),
-  notificationReceived(false),
+  serviceChangedHandle(0),
+  mtu(ATT_DEFAULT_LE_MTU),
   btleError(0),
-  notificationBuffer(make_shared<std::vector<uint8_t>>()) {
+  notificationRing(NOTIFICATION_BUFFER_SIZE),
+  owedTimer(0),
+  nextRequestId(1),
+  cachedHandleUnverified(false),
+  recoveryTimer(0),
+  recoveryAttempts(0),
+  openCircuit(false) {
 
   g_mutex_init(&mutex);
-  BluetoothGuard::lockBluetooth(this);
+  g_cond_init(&stateCondition);
+  BtleReactor::attach();
 }
 
 BtleCommWrapper::~BtleCommWrapper() {
   disconnect();
-  g_main_loop_quit(eventLoop);
-  g_thread_join(eventLoopThread); //this also do unref inside!
-  g_main_loop_unref(eventLoop);
+  BtleReactor::detach();
+  g_cond_clear(&stateCondition);
   printf("BTLE Destroyed\n");
-  BluetoothGuard::unlockBluetooth(this);
 }
 
 bool BtleCommWrapper::isConnectingInProgress() {
@@ -88,6 +222,7 @@ bool BtleCommWrapper::isConnectingInProgress() {
 void BtleCommWrapper::setBtleError(int error) {
   g_mutex_lock(&mutex);
   this->btleError = error;
+  g_cond_broadcast(&stateCondition);
   g_mutex_unlock(&mutex);
 }
 
@@ -101,7 +236,21 @@ bool BtleCommWrapper::isBtleError() {
 void BtleCommWrapper::setState(ConnectionStatusState state) {
   g_mutex_lock(&mutex);
   this->state = state;
+  g_cond_broadcast(&stateCondition);
+  g_mutex_unlock(&mutex);
+}
+
+//Blocks until state is different than enterState, error is reported or endTime (monotonic, in us)
+bool BtleCommWrapper::waitForStateChange(ConnectionStatusState enterState, gint64 endTime) {
+  g_mutex_lock(&mutex);
+  while ((state == enterState) && (btleError == 0)) {
+    if (g_cond_wait_until(&stateCondition, &mutex, endTime) == false) {
+      break;
+    }
+  }
+  bool result = (state != enterState) || (btleError != 0);
   g_mutex_unlock(&mutex);
+  return result;
 }
 
 ConnectionStatusState BtleCommWrapper::getState() {
@@ -120,66 +269,115 @@ bool BtleCommWrapper::isConnected() {
   return result;
 }
 
+//Next action is decided by retry policy of error code. Retry is delayed by recovery timer on event loop,
+//meanwhile state is cssBackoff and connectTo() just waits for state change.
 NextAction BtleCommWrapper::handleBtleError() {
   g_mutex_lock(&mutex);
   int errorCode = btleError;
   btleError = 0;
   g_mutex_unlock(&mutex);
 
-  NextAction result = naContinue;
-
-  printf("%s: error %d\n", __func__, errorCode);
+  if (errorCode == 0) {
+    return naContinue;
+  }
 
-  switch (errorCode) {
-    case 0:
-      //no error
-      result = naContinue;
-      break;
+  RetryPolicy policy = BtleRecoveryPolicy::getPolicy(errorCode);
+  recoveryAttempts++;
+  printf("%s: error %d, attempt %d\n", __func__, errorCode, recoveryAttempts);
 
-    case 16:
-      //resource busy
-      //Since we are going to destroy whole BTLE, fallback to connect state
-      deleteBtleAttrib();
-      deleteBtleChannel();
-      setState(cssNone);
+  if (policy.opensCircuit == true) {
+    openCircuit = true;
+  }
+  if ((policy.action == raFail) || (recoveryAttempts > policy.maxAttempts)) {
+    printf("%s: nextAction:%d\n", __func__, naFatal);
+    return naFatal;
+  }
 
+  //retry starts from scratch, fallback to connect state
+  BtleReactor::invoke([this]() { closeConnection(); });
+  if (policy.action == raRestartAdapter) {
+    //restart would break other links, then it's just retry
+    if (BluetoothGuard::tryLockBluetooth(this) == true) {
       HciWrapper::restartBTLE();
-      usleep(3 * 1000000);
-      result = naRepeat;
-      break;
+      BluetoothGuard::unlockBluetooth(this);
+    } else {
+      printf("%s: other links are open, adapter not restarted\n", __func__);
+    }
+  }
+  int delayInMs = BtleRecoveryPolicy::getRetryDelayInMs(policy, recoveryAttempts);
+  scheduleRecovery(delayInMs);
+  printf("%s: nextAction:%d, retry in %d ms\n", __func__, naRepeat, delayInMs);
+  return naRepeat;
+}
 
-    case 130:
-      //operation aborted, just wait and restart
-      usleep(3 * 1000000);
-      result = naRepeat;
-      break;
+void BtleCommWrapper::scheduleRecovery(int delayInMs) {
+  cancelRecovery();
+  g_mutex_lock(&mutex);
+  state = cssBackoff;
+  recoveryTarget = make_shared<RecoveryTimer>(this);
+  recoveryTimer = g_timeout_add_full(G_PRIORITY_DEFAULT, delayInMs, BtleCommWrapper::recoveryTimerHandler,
+      new RecoveryTimerRef(recoveryTarget), deleteRecoveryTimerRef);
+  g_cond_broadcast(&stateCondition);
+  g_mutex_unlock(&mutex);
+}
 
-    case 148:
-      //Host is unreachable
-      result = naFatal;
-      break;
+//After return recoveryTimerHandler doesn't touch this wrapper any more
+void BtleCommWrapper::cancelRecovery() {
+  std::shared_ptr<RecoveryTimer> target;
+  g_mutex_lock(&mutex);
+  target.swap(recoveryTarget);
+  if (recoveryTimer != 0) {
+    g_source_remove(recoveryTimer);
+    recoveryTimer = 0;
+  }
+  g_mutex_unlock(&mutex);
+  if (target != nullptr) {
+    //handler may be already running, it holds target mutex till the end
+    std::lock_guard<std::mutex> guard(target->mutex);
+    target->btleCom = nullptr;
+  }
+}
 
-    default:
-      result = naRepeat;
-      usleep(1 * 1000000);
-      break;
+gboolean BtleCommWrapper::recoveryTimerHandler(gpointer user_data) {
+  std::shared_ptr<RecoveryTimer> target = static_cast<RecoveryTimerRef*>(user_data)->timer;
+  std::lock_guard<std::mutex> guard(target->mutex);
+  BtleCommWrapper* btleCom = target->btleCom;
+  if (btleCom == nullptr) {
+    //cancelled while being dispatched
+    return false;
   }
-  printf("%s: nextAction:%d\n", __func__, result);
-  return result;
+  g_mutex_lock(&btleCom->mutex);
+  btleCom->recoveryTimer = 0;
+  if (btleCom->state == cssBackoff) {
+    btleCom->state = cssNone;
+    g_cond_broadcast(&btleCom->stateCondition);
+  }
+  g_mutex_unlock(&btleCom->mutex);
+  return false;
 }
 
 void BtleCommWrapper::deleteBtleAttrib() {
   g_mutex_lock(&mutex);
-  if (btleAttribute != nullptr) {
-    g_attrib_unref(btleAttribute);
+  GAttrib* attrib = btleAttribute;
+  btleAttribute = nullptr;
+  serviceChangedHandle = 0;
+  g_mutex_unlock(&mutex);
+  //unref calls destroy notifies of queued commands (writeCommandSent), they take mutex again
+  if (attrib != nullptr) {
+    //pending discovery holds its own reference, callbacks mustn't come after disconnect anyway
+    g_attrib_unregister_all(attrib);
+    g_attrib_cancel_all(attrib);
+    g_attrib_unref(attrib);
     printf("1: %s btleAttribute=null\n", __func__);
-    btleAttribute = nullptr;
   }
-  g_mutex_unlock(&mutex);
 }
 
 void BtleCommWrapper::deleteBtleChannel() {
   g_mutex_lock(&mutex);
+  if (channelWatchSource != 0) {
+    g_source_remove(channelWatchSource);
+    channelWatchSource = 0;
+  }
   if (btleChannel != nullptr) {
     GError* error = nullptr;
     g_io_channel_shutdown(btleChannel, true, &error);
@@ -194,6 +392,18 @@ void BtleCommWrapper::deleteBtleChannel() {
   g_mutex_unlock(&mutex);
 }
 
+//Event loop thread, so no GLib callback of this connection runs meanwhile and none comes afterwards
+void BtleCommWrapper::closeConnection() {
+  deleteBtleAttrib();
+  deleteBtleChannel();
+  //attrib is gone, so callbacks of long writes won't come any more
+  std::lock_guard<std::mutex> guard(notificationMutex);
+  for (auto& ref : longWriteRefs) {
+    ref.second(ref.first);
+  }
+  longWriteRefs.clear();
+}
+
 void BtleCommWrapper::connectCallback(GIOChannel *io, GError *err, gpointer user_data) {
   printf("%s, %p\n", __func__, io);
   BtleCommWrapper* btleCom = static_cast<BtleCommWrapper*>(user_data);
@@ -249,40 +459,204 @@ void BtleCommWrapper::discoverCharacteristicCallback(GSList *characteristics, ui
     struct gatt_char *characteristic = (struct gatt_char *) characteristics->data;
     g_mutex_lock(&callbackData->btleCom->mutex);
     callbackData->btleCom->btleValueHandle = characteristic->value_handle;
-
-    g_attrib_register(callbackData->btleAttribute, ATT_OP_HANDLE_NOTIFY, GATTRIB_ALL_HANDLES,
-        BtleCommWrapper::notificationEventsHandler, callbackData->btleCom, NULL);
-    g_attrib_register(callbackData->btleAttribute, ATT_OP_HANDLE_IND, GATTRIB_ALL_HANDLES,
-        BtleCommWrapper::notificationEventsHandler, callbackData->btleCom, NULL);
+    callbackData->btleCom->registerNotifications(callbackData->btleAttribute);
+    string address = callbackData->btleCom->address;
     g_mutex_unlock(&callbackData->btleCom->mutex);
 
+    GattHandleCache::store(address, CHAR_UUID, characteristic->value_handle);
+
     callbackData->btleCom->setState(cssConnectionEstablished);
   }
 
   delete callbackData;
 }
 
+//Must be called with mutex locked
+void BtleCommWrapper::registerNotifications(GAttrib* attrib) {
+  g_attrib_register(attrib, ATT_OP_HANDLE_NOTIFY, GATTRIB_ALL_HANDLES,
+      BtleCommWrapper::notificationEventsHandler, this, NULL);
+  g_attrib_register(attrib, ATT_OP_HANDLE_IND, GATTRIB_ALL_HANDLES,
+      BtleCommWrapper::notificationEventsHandler, this, NULL);
+}
+
+//Service Changed is indicated only to subscribed clients, its handle tells it apart from other indications.
+//Requests are queued behind discovery of our characteristic, so they don't delay connect.
+void BtleCommWrapper::subscribeServiceChanged() {
+  guint16 valueHandle = 0;
+  guint16 configHandle = 0;
+  if (GattHandleCache::lookup(address, SERVICE_CHANGED_UUID, valueHandle) == true &&
+      GattHandleCache::lookup(address, SERVICE_CHANGED_CONFIG_UUID, configHandle) == true) {
+    writeServiceChangedConfig(new BtleCallbackData(this, btleChannel, btleAttribute, valueHandle), configHandle);
+    return;
+  }
+
+  bt_uuid_t uuid;
+  bt_uuid16_create(&uuid, GATT_CHARAC_SERVICE_CHANGED);
+  gatt_discover_char(btleAttribute, 0x0001, 0xffff, &uuid, BtleCommWrapper::serviceChangedDiscoveredCallback,
+      new BtleCallbackData(this, btleChannel, btleAttribute));
+}
+
+void BtleCommWrapper::serviceChangedDiscoveredCallback(GSList *characteristics, uint8_t status, void *user_data) {
+  BtleCallbackData* callbackData = static_cast<BtleCallbackData*>(user_data);
+  BtleCommWrapper* btleCom = callbackData->btleCom;
+
+  g_mutex_lock(&btleCom->mutex);
+  if ((callbackData->btleAttribute != btleCom->btleAttribute) || (callbackData->btleChannel != btleCom->btleChannel)) {
+    printf("%s: Zombie callback, ignored!\n", __func__);
+    g_mutex_unlock(&btleCom->mutex);
+    delete callbackData;
+    return;
+  }
+  g_mutex_unlock(&btleCom->mutex);
+
+  struct gatt_char *characteristic = nullptr;
+  if (status == 0 && characteristics != nullptr) {
+    characteristic = (struct gatt_char *) characteristics->data;
+  }
+  if (characteristic == nullptr || characteristic->value_handle == 0xffff) {
+    //without Service Changed handles never change
+    printf("%s: no Service Changed characteristic\n", __func__);
+    delete callbackData;
+    return;
+  }
+
+  //descriptors follow value, client configuration is looked up before next declaration
+  callbackData->btleValueHandle = characteristic->value_handle;
+  if (gatt_find_info(callbackData->btleAttribute, characteristic->value_handle + 1, 0xffff,
+      BtleCommWrapper::serviceChangedDescriptorsCallback, callbackData) == 0) {
+    delete callbackData;
+  }
+}
+
+void BtleCommWrapper::serviceChangedDescriptorsCallback(guint8 status, const guint8 *pdu, guint16 plen,
+    gpointer user_data) {
+  BtleCallbackData* callbackData = static_cast<BtleCallbackData*>(user_data);
+  BtleCommWrapper* btleCom = callbackData->btleCom;
+
+  g_mutex_lock(&btleCom->mutex);
+  if ((callbackData->btleAttribute != btleCom->btleAttribute) || (callbackData->btleChannel != btleCom->btleChannel)) {
+    printf("%s: Zombie callback, ignored!\n", __func__);
+    g_mutex_unlock(&btleCom->mutex);
+    delete callbackData;
+    return;
+  }
+  string address = btleCom->address;
+  g_mutex_unlock(&btleCom->mutex);
+
+  guint16 configHandle = 0;
+  uint8_t format = 0;
+  struct att_data_list* list = status == 0 ? dec_find_info_resp(pdu, plen, &format) : nullptr;
+  if (list != nullptr) {
+    //client configuration is always 16 bit UUID
+    for (int i = 0; format == ATT_FIND_INFO_RESP_FMT_16BIT && i < list->num; i++) {
+      uint16_t type = att_get_u16(&list->data[i][2]);
+      if (type == GATT_CLIENT_CHARAC_CFG_UUID) {
+        configHandle = att_get_u16(list->data[i]);
+        break;
+      }
+      if (type == GATT_PRIM_SVC_UUID || type == GATT_SND_SVC_UUID || type == GATT_CHARAC_UUID) {
+        break;
+      }
+    }
+    att_data_list_free(list);
+  }
+  if (configHandle == 0) {
+    g_warning("Service Changed can't be subscribed\n");
+    delete callbackData;
+    return;
+  }
+
+  GattHandleCache::store(address, SERVICE_CHANGED_UUID, callbackData->btleValueHandle);
+  GattHandleCache::store(address, SERVICE_CHANGED_CONFIG_UUID, configHandle);
+  btleCom->writeServiceChangedConfig(callbackData, configHandle);
+}
+
+void BtleCommWrapper::writeServiceChangedConfig(BtleCallbackData* callbackData, guint16 configHandle) {
+  uint8_t value[2];
+  att_put_u16(GATT_CLIENT_CHARAC_CFG_IND_BIT, value);
+  if (gatt_write_char(callbackData->btleAttribute, configHandle, value, sizeof(value),
+      BtleCommWrapper::serviceChangedSubscribedCallback, callbackData) == 0) {
+    delete callbackData;
+  }
+}
+
+void BtleCommWrapper::serviceChangedSubscribedCallback(guint8 status, const guint8 *pdu, guint16 plen,
+    gpointer user_data) {
+  BtleCallbackData* callbackData = static_cast<BtleCallbackData*>(user_data);
+  BtleCommWrapper* btleCom = callbackData->btleCom;
+
+  g_mutex_lock(&btleCom->mutex);
+  if ((callbackData->btleAttribute != btleCom->btleAttribute) || (callbackData->btleChannel != btleCom->btleChannel)) {
+    printf("%s: Zombie callback, ignored!\n", __func__);
+    g_mutex_unlock(&btleCom->mutex);
+    delete callbackData;
+    return;
+  }
+  if (status == 0) {
+    btleCom->serviceChangedHandle = callbackData->btleValueHandle;
+    printf("%s: Service Changed 0x%04x\n", __func__, btleCom->serviceChangedHandle);
+  }
+  g_mutex_unlock(&btleCom->mutex);
+
+  if (status != 0) {
+    //cached handles of the device may be stale too
+    g_warning("Service Changed subscription failed: %s\n", att_ecode2str(status));
+    btleCom->invalidateHandleCache();
+  }
+  delete callbackData;
+}
+
+//Cached handle may be stale, next connect runs full discovery
+void BtleCommWrapper::invalidateHandleCache() {
+  g_mutex_lock(&mutex);
+  string address = this->address;
+  g_mutex_unlock(&mutex);
+  GattHandleCache::invalidate(address);
+}
+
+//Stale handle doesn't always end with ATT error (write commands are not acknowledged), so first
+//timeout of connection made with cached handle invalidates it too. Any success confirms the handle.
+void BtleCommWrapper::checkCachedHandle(bool failed) {
+  if (cachedHandleUnverified.exchange(false) == true && failed == true) {
+    printf("%s: cached handle didn't work\n", __func__);
+    invalidateHandleCache();
+  }
+}
+
 void BtleCommWrapper::notificationEventsHandler(const uint8_t *pdu, uint16_t len, gpointer user_data) {
-  GAttrib *attrib = (GAttrib *) user_data;
   uint8_t *opdu;
   uint16_t i, olen = 0;
   size_t plen;
 
   BtleCommWrapper* wrapper = (BtleCommWrapper*) user_data;
-  //uint16_t handle = att_get_u16(&pdu[1]);
 
   switch (pdu[0]) {
-    case ATT_OP_HANDLE_NOTIFY: {
-      std::lock_guard<std::mutex> guard(wrapper->notificationMutex);
-      for (i = 3; i < len; i++) {
-        wrapper->notificationBuffer->push_back(pdu[i]);
-//        printf("%c", pdu[i]);
+    case ATT_OP_HANDLE_NOTIFY:
+      wrapper->checkCachedHandle(false);
+      if (len > 3 && wrapper->notificationRing.append(pdu + 3, len - 3) == false) {
+        g_warning("Notification buffer overflow, line dropped\n");
       }
-      wrapper->notificationReceived = true;
-    }
+      wrapper->dispatchResponses();
+      {
+        //empty critical section, so reader can't miss notify between its check and wait
+        std::lock_guard<std::mutex> guard(wrapper->notificationMutex);
+      }
+      wrapper->notificationCondition.notify_all();
       break;
 
     case ATT_OP_HANDLE_IND:
+      if (len >= 3) {
+        uint16_t handle = att_get_u16(&pdu[1]);
+        g_mutex_lock(&wrapper->mutex);
+        bool serviceChanged = wrapper->serviceChangedHandle != 0 && handle == wrapper->serviceChangedHandle;
+        g_mutex_unlock(&wrapper->mutex);
+        if (serviceChanged == true) {
+          //handles may have moved
+          wrapper->invalidateHandleCache();
+        } else {
+          g_info("Indication of 0x%04x ignored\n", handle);
+        }
+      }
       for (i = 3; i < len; i++) {
         g_info("%02x ", pdu[i]);
       }
@@ -298,16 +672,59 @@ void BtleCommWrapper::notificationEventsHandler(const uint8_t *pdu, uint16_t len
     return;
   }
 
-  opdu = g_attrib_get_buffer(attrib, &plen);
-  olen = enc_confirmation(opdu, plen);
+  //user_data is wrapper, indication is confirmed on its current attrib
+  g_mutex_lock(&wrapper->mutex);
+  GAttrib *attrib = wrapper->btleAttribute;
+  if (attrib != nullptr) {
+    opdu = g_attrib_get_buffer(attrib, &plen);
+    olen = enc_confirmation(opdu, plen);
 
-  if (olen > 0) {
-    g_attrib_send(attrib, 0, opdu, olen, NULL, NULL, NULL);
+    if (olen > 0) {
+      g_attrib_send(attrib, 0, opdu, olen, NULL, NULL, NULL);
+    }
   }
+  g_mutex_unlock(&wrapper->mutex);
+}
+
+void BtleCommWrapper::exchangeMtuCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data) {
+  BtleCallbackData* callbackData = static_cast<BtleCallbackData*>(user_data);
+  BtleCommWrapper* btleCom = callbackData->btleCom;
+
+  g_mutex_lock(&btleCom->mutex);
+  if ((callbackData->btleAttribute != btleCom->btleAttribute) || (callbackData->btleChannel != btleCom->btleChannel)) {
+    printf("%s: Zombie callback, ignored!\n", __func__);
+    g_mutex_unlock(&btleCom->mutex);
+    delete callbackData;
+    return;
+  }
+
+  guint16 serverMtu = 0;
+  if (status != 0 || dec_mtu_resp(pdu, plen, &serverMtu) == 0) {
+    //not fatal, default MTU is used
+    g_warning("MTU exchange failed: %s\n", att_ecode2str(status));
+  } else {
+    guint16 mtu = MIN(serverMtu, REQUESTED_MTU);
+    if (g_attrib_set_mtu(callbackData->btleAttribute, mtu) == TRUE) {
+      btleCom->mtu = mtu;
+    }
+    printf("%s: MTU=%d\n", __func__, btleCom->mtu);
+  }
+  g_mutex_unlock(&btleCom->mutex);
+  delete callbackData;
 }
 
 void BtleCommWrapper::writeValueCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data) {
-    ReadSyncBlock* result = static_cast<ReadSyncBlock*>(user_data);
+    std::shared_ptr<WriteRequestSync> sync = static_cast<WriteRequestSyncRef*>(user_data)->sync;
+
+    g_mutex_lock(&sync->mutex);
+    bool abandoned = sync->abandoned;
+    g_mutex_unlock(&sync->mutex);
+    if (abandoned == true) {
+        printf("%s: late write response dropped\n", __func__);
+        return;
+    }
+
+    ReadSyncBlock* result = &sync->block;
     result->resultSize = status;
 
     if (status != 0) {
@@ -326,9 +743,24 @@ void BtleCommWrapper::writeValueCallback(guint8 status, const guint8 *pdu, guint
     result->setReady();
 }
 
+//Callbacks of queued commands are dropped by disconnect(), so btleCom is valid when this one comes
+void BtleCommWrapper::writeValueLongCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data) {
+  WriteRequestSyncRef* ref = static_cast<WriteRequestSyncRef*>(user_data);
+  writeValueCallback(status, pdu, plen, user_data);
+  {
+    std::lock_guard<std::mutex> guard(ref->sync->btleCom->notificationMutex);
+    ref->sync->btleCom->longWriteRefs.erase(ref);
+  }
+  delete ref;
+}
+
 gboolean BtleCommWrapper::channelWatch(GIOChannel* source, GIOCondition condition, gpointer data) {
   printf("In channel error -> disconnected state\n");
   BtleCommWrapper* btleCom = static_cast<BtleCommWrapper*>(data);
+  g_mutex_lock(&btleCom->mutex);
+  //removed by returning false
+  btleCom->channelWatchSource = 0;
+  g_mutex_unlock(&btleCom->mutex);
   btleCom->disconnect();
   return false;
 }
@@ -339,6 +771,10 @@ void BtleCommWrapper::executeConnect(const string& address) {
   GError* error = nullptr;
   gpointer data = static_cast<gpointer>(this);
 
+  g_mutex_lock(&mutex);
+  this->address = address;
+  g_mutex_unlock(&mutex);
+
   btleChannel = gatt_connect("hci0", address.c_str(), "", "low", 0, 0, BtleCommWrapper::connectCallback, &error, data);
   if (btleChannel == nullptr) {
     g_warning("Failed to connect with error: %s", error->message);
@@ -348,7 +784,11 @@ void BtleCommWrapper::executeConnect(const string& address) {
 
   } else {
     //watch this channel
-    g_io_add_watch(btleChannel, static_cast<GIOCondition>(G_IO_ERR | G_IO_HUP), BtleCommWrapper::channelWatch, this);
+    guint watch = g_io_add_watch(btleChannel, static_cast<GIOCondition>(G_IO_ERR | G_IO_HUP),
+        BtleCommWrapper::channelWatch, this);
+    g_mutex_lock(&mutex);
+    channelWatchSource = watch;
+    g_mutex_unlock(&mutex);
     setBtleError(0);
     setState(cssConnect);
   }
@@ -367,8 +807,27 @@ void BtleCommWrapper::executeDiscovery(int timeoutInMs, gint64 startTime) {
       return;
     }
 
+    //requests are serialized by GAttrib, so MTU is known before discovery completes
+    gatt_exchange_mtu(btleAttribute, REQUESTED_MTU, BtleCommWrapper::exchangeMtuCallback,
+        new BtleCallbackData(this, btleChannel, btleAttribute));
+
+    guint16 cachedHandle = 0;
+    if (GattHandleCache::lookup(address, CHAR_UUID, cachedHandle) == true) {
+      //reconnect, discovery round trips are skipped
+      printf("%s: cached handle 0x%04x\n", __func__, cachedHandle);
+      g_mutex_lock(&mutex);
+      btleValueHandle = cachedHandle;
+      registerNotifications(btleAttribute);
+      g_mutex_unlock(&mutex);
+      cachedHandleUnverified = true;
+      subscribeServiceChanged();
+      setState(cssConnectionEstablished);
+      return;
+    }
+
     BtleCallbackData* data = new BtleCallbackData(this, btleChannel, btleAttribute);
     gatt_discover_char(btleAttribute, 0x0001, 0xffff, &uuid, BtleCommWrapper::discoverCharacteristicCallback, data);
+    subscribeServiceChanged();
     setState(cssDiscover);
 
   } else {
@@ -377,10 +836,27 @@ void BtleCommWrapper::executeDiscovery(int timeoutInMs, gint64 startTime) {
 }
 
 void BtleCommWrapper::disconnect() {
-  deleteBtleAttrib();
-  deleteBtleChannel();
+  cancelRecovery();
+  cachedHandleUnverified = false;
+  //GLib callbacks use this wrapper on event loop thread, so it's torn down there and can't race with them
+  BtleReactor::invoke([this]() {
+    closeConnection();
+    //attrib is gone already, so request queued meanwhile fails at write instead of being left pending
+    abortRequests();
+    //no more notifications, bytes of this connection mustn't leak into first response of next one.
+    //Event loop thread is the producer, reader skips dropped lines itself after its borrowed line.
+    notificationRing.clear();
+  });
+  g_mutex_lock(&mutex);
+  mtu = ATT_DEFAULT_LE_MTU;
+  g_mutex_unlock(&mutex);
   setState(cssNone);
   setBtleError(0);
+  BluetoothGuard::releaseLink(this);
+  //file isn't written on event loop thread (HUP), it's left for next connectTo()/disconnect()
+  if (BtleReactor::isReactorThread() == false) {
+    GattHandleCache::flush();
+  }
   printf("--DISCONNECTED\n");
 }
 
@@ -391,9 +867,32 @@ bool BtleCommWrapper::connectTo(const string& address, gint64 timeoutInMs) {
     return false;
   }
 
-  timeoutInMs *= 1000;
+  //unreachable device is not tried until its circuit closes, so it doesn't stall others
+  if (BtleCircuitBreaker::allowAttempt(address) == false) {
+    g_warning("Circuit of %s is open, not connecting", address.c_str());
+    return false;
+  }
 
+  //link slot is kept until disconnect(), only creation of connection is exclusive
   gint64 startTime = g_get_monotonic_time();
+  if (BluetoothGuard::acquireLink(this, (int) timeoutInMs) == false) {
+    g_warning("No free link for %s", address.c_str());
+    BtleCircuitBreaker::abandonAttempt(address);
+    return false;
+  }
+  gint64 remainingMs = MAX(0, timeoutInMs - (g_get_monotonic_time() - startTime) / 1000);
+  if (BluetoothGuard::beginConnect(this, (int) remainingMs) == false) {
+    g_warning("Adapter busy, unable to connect to %s", address.c_str());
+    BtleCircuitBreaker::abandonAttempt(address);
+    BluetoothGuard::releaseLink(this);
+    return false;
+  }
+  bool connectGuarded = true;
+  recoveryAttempts = 0;
+  openCircuit = false;
+
+  timeoutInMs *= 1000;
+
   int attempt = 0;
   while (g_get_monotonic_time() - startTime < timeoutInMs) {
     attempt++;
@@ -401,9 +900,24 @@ bool BtleCommWrapper::connectTo(const string& address, gint64 timeoutInMs) {
 
     switch( getState() ) {
       case cssNone:
+        if (connectGuarded == false) {
+          remainingMs = MAX(0, (timeoutInMs - (g_get_monotonic_time() - startTime)) / 1000);
+          if (BluetoothGuard::beginConnect(this, (int) remainingMs) == false) {
+            goto exitFromWhile;
+          }
+          connectGuarded = true;
+        }
         executeConnect(address);
         break;
 
+      case cssBackoff:
+        //others can connect while we wait for retry
+        if (connectGuarded == true) {
+          BluetoothGuard::endConnect(this);
+          connectGuarded = false;
+        }
+        break;
+
       case cssDiscover:
         executeDiscovery(timeoutInMs, startTime);
         break;
@@ -431,23 +945,20 @@ bool BtleCommWrapper::connectTo(const string& address, gint64 timeoutInMs) {
       break;
     }
 
+    //established without callback (cached handle)
+    if (getState() == cssConnectionEstablished) {
+      break;
+    }
+
     //wait until some callbacks
     ConnectionStatusState enterState = getState();
     printf("Waiting for callback or error\n");
 
-    while (true) {
+    if (waitForStateChange(enterState, startTime + timeoutInMs) == true) {
+      printf("Break wait, curState=%d, enterState=%d, isError=%d\n", getState(), enterState, isBtleError());
+    } else {
       gint64 curTime = g_get_monotonic_time();
-      if( curTime - startTime > timeoutInMs) {
-        printf("Timeout: %lld, %lld, %lld\n",curTime - startTime, curTime, startTime);
-        break;
-      }
-
-      ConnectionStatusState curState = getState();
-      if ((curState != enterState) || isBtleError()) {
-        printf("Break sleep, curState=%d, enterState=%d, isError=%d\n", curState, enterState, isBtleError());
-        break;
-      }
-      usleep(30 * 1000);
+      printf("Timeout: %lld, %lld, %lld\n",curTime - startTime, curTime, startTime);
     }
 
     //post callback error handling
@@ -462,98 +973,553 @@ bool BtleCommWrapper::connectTo(const string& address, gint64 timeoutInMs) {
   }
 
   exitFromWhile:
+  if (connectGuarded == true) {
+    BluetoothGuard::endConnect(this);
+  }
   bool result = isConnected();
   if (result == false) {
-    deleteBtleAttrib();
-    deleteBtleChannel();
+    cancelRecovery();
+    BtleCircuitBreaker::recordFailure(address, openCircuit);
+    BtleReactor::invoke([this]() { closeConnection(); });
     setState(cssNone);
     setBtleError(0);
+    BluetoothGuard::releaseLink(this);
     g_warning("Unable to connect to %s", address.c_str());
   } else {
+    BtleCircuitBreaker::recordSuccess(address);
     printf(" ---- Connection success\n");
   }
+  //discovered handles are stored on event loop thread, file is written here
+  GattHandleCache::flush();
   return result;
 }
 
-bool BtleCommWrapper::send(const string& dataToSend, int timeoutInMs) {
+bool BtleCommWrapper::send(const string& dataToSend, int timeoutInMs, SendMode mode) {
   if (isConnected() == false) {
     g_warning("Not connected!");
     return false;
   }
+  if (mode == smWriteCommand) {
+    return sendWriteCommands(dataToSend, timeoutInMs);
+  }
 
-  bool result = false;
-  gsize plen = dataToSend.length();
-  uint8_t *value = (uint8_t *) g_try_malloc0(plen + 1);
-  strcpy((char*) value, dataToSend.c_str());
-  if (plen != 0) {
-    ReadSyncBlock data(&this->mutex);
+  if (dataToSend.empty() == true) {
+    return false;
+  }
 
-    gatt_write_char(btleAttribute, btleValueHandle, value, plen, BtleCommWrapper::writeValueCallback, &data);
+  //GAttrib is used only from event loop thread, write is queued there
+  std::shared_ptr<WriteRequestSync> sync = make_shared<WriteRequestSync>(this, dataToSend);
+  g_idle_add_full(G_PRIORITY_DEFAULT, BtleCommWrapper::startWriteRequest, new WriteRequestSyncRef(sync),
+      deleteWriteRequestSyncRef);
 
-    const int sleepTimeMs = 30;
-    gint64 startTime = g_get_monotonic_time();
-    timeoutInMs *= 1000;
+  //woken up by writeValueCallback
+  gint64 startTime = g_get_monotonic_time();
+  bool ready = sync->block.waitReady(startTime + (gint64) timeoutInMs * 1000);
+  if (ready == false) {
+    g_mutex_lock(&sync->mutex);
+    sync->abandoned = true;
+    g_mutex_unlock(&sync->mutex);
+    gint64 curTime = g_get_monotonic_time();
+    printf("Send Timeout: %lld, %lld, %lld\n", curTime - startTime, curTime, startTime);
+    checkCachedHandle(true);
+  }
+  bool result = ready && (sync->block.resultSize == 0);
+  if (ready == true && sync->block.resultSize != 0) {
+    invalidateHandleCache();
+  } else if (ready == true) {
+    checkCachedHandle(false);
+  }
 
-    while (true) {
-      if (data.isReady() == true) {
-        break;
+  return result;
+}
+
+//Event loop thread, btleCom is used only while send() still waits
+gboolean BtleCommWrapper::startWriteRequest(gpointer user_data) {
+  std::shared_ptr<WriteRequestSync> sync = static_cast<WriteRequestSyncRef*>(user_data)->sync;
+  GAttrib* attrib = nullptr;
+  guint16 handle = 0;
+  g_mutex_lock(&sync->mutex);
+  if (sync->abandoned == false) {
+    BtleCommWrapper* btleCom = sync->btleCom;
+    g_mutex_lock(&btleCom->mutex);
+    attrib = g_attrib_ref(btleCom->btleAttribute);
+    handle = btleCom->btleValueHandle;
+    g_mutex_unlock(&btleCom->mutex);
+  }
+  g_mutex_unlock(&sync->mutex);
+
+  guint sent = 0;
+  if (attrib != nullptr && handle != 0) {
+    size_t bufferSize;
+    uint8_t* buffer = g_attrib_get_buffer(attrib, &bufferSize);
+    if (sync->data.size() <= bufferSize - WRITE_COMMAND_HEADER_SIZE) {
+      //GAttrib frees ref also when it's destroyed before response comes
+      guint16 plen = enc_write_req(handle, (uint8_t*) sync->data.data(), sync->data.size(), buffer, bufferSize);
+      sent = g_attrib_send(attrib, 0, buffer, plen, BtleCommWrapper::writeValueCallback,
+          new WriteRequestSyncRef(sync), deleteWriteRequestSyncRef);
+    } else {
+      //long write has no destroy notify, ref is kept by wrapper until callback or disconnect()
+      WriteRequestSyncRef* ref = new WriteRequestSyncRef(sync);
+      BtleCommWrapper* btleCom = sync->btleCom;
+      {
+        std::lock_guard<std::mutex> guard(btleCom->notificationMutex);
+        btleCom->longWriteRefs[ref] = deleteWriteRequestSyncRef;
       }
-      gint64 curTime = g_get_monotonic_time();
-      if (curTime - startTime > timeoutInMs) {
-        printf("Send Timeout: %lld, %lld, %lld\n", curTime - startTime, curTime, startTime);
-        break;
+      sent = gatt_write_char(attrib, handle, (uint8_t*) sync->data.data(), sync->data.size(),
+          BtleCommWrapper::writeValueLongCallback, ref);
+      if (sent == 0) {
+        {
+          std::lock_guard<std::mutex> guard(btleCom->notificationMutex);
+          btleCom->longWriteRefs.erase(ref);
+        }
+        delete ref;
       }
-      usleep(sleepTimeMs * 1000);
     }
-    g_free(value);
-    result = data.resultSize == 0;
+  }
+  g_attrib_unref(attrib);
+  if (sent == 0) {
+    sync->block.resultSize = 1;
+    sync->block.setReady();
+  }
+  return false;
+}
+
+bool BtleCommWrapper::sendWriteCommands(const string& data, int timeoutInMs) {
+  if (data.empty() == true) {
+    return false;
+  }
+  std::shared_ptr<WriteCommandStream> stream = make_shared<WriteCommandStream>(this, data);
+  g_idle_add_full(G_PRIORITY_DEFAULT, BtleCommWrapper::startWriteCommands, new WriteCommandStreamRef(stream),
+      deleteWriteCommandStreamRef);
+
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(stream->mutex);
+  if (stream->condition.wait_until(lock, startTime + std::chrono::milliseconds(timeoutInMs),
+      [&stream]() { return stream->finished; }) == false) {
+    //queued chunks will still be sent, but no new ones
+    printf("Send Timeout: %d ms\n", timeoutInMs);
+    stream->finished = true;
+    stream->failed = true;
+    lock.unlock();
+    checkCachedHandle(true);
+    return false;
+  }
+  return stream->failed == false;
+}
+
+gboolean BtleCommWrapper::startWriteCommands(gpointer user_data) {
+  pumpWriteCommands(static_cast<WriteCommandStreamRef*>(user_data)->stream);
+  return false;
+}
+
+//Called by GAttrib when chunk was written to socket (or dropped with GAttrib), credit is returned.
+//Event loop thread in both cases, GAttrib is released by closeConnection() there.
+void BtleCommWrapper::writeCommandSent(gpointer user_data) {
+  WriteCommandStreamRef* ref = static_cast<WriteCommandStreamRef*>(user_data);
+  std::shared_ptr<WriteCommandStream> stream = ref->stream;
+  delete ref;
+  stream->inFlight--;
+  pumpWriteCommands(stream);
+}
+
+//Event loop thread, queues chunks while there are credits
+void BtleCommWrapper::pumpWriteCommands(const std::shared_ptr<WriteCommandStream>& stream) {
+  if (stream->isFinished() == true) {
+    return;
+  }
+  BtleCommWrapper* btleCom = stream->btleCom;
+
+  while ((stream->inFlight < WRITE_COMMAND_CREDITS) && (stream->offset < stream->data.size())) {
+    g_mutex_lock(&btleCom->mutex);
+    GAttrib* attrib = g_attrib_ref(btleCom->btleAttribute);
+    guint16 handle = btleCom->btleValueHandle;
+    size_t mtu = btleCom->mtu;
+    g_mutex_unlock(&btleCom->mutex);
+    if (attrib == nullptr || handle == 0) {
+      g_attrib_unref(attrib);
+      stream->finish(true);
+      return;
+    }
+
+    size_t chunk = std::min(stream->data.size() - stream->offset, mtu - WRITE_COMMAND_HEADER_SIZE);
+
+    WriteCommandStreamRef* ref = new WriteCommandStreamRef(stream);
+    guint sent = gatt_write_cmd(attrib, handle, (uint8_t*) stream->data.data() + stream->offset, chunk,
+        BtleCommWrapper::writeCommandSent, ref);
+    g_attrib_unref(attrib);
+    if (sent == 0) {
+      delete ref;
+      g_warning("Write command failed\n");
+      stream->finish(true);
+      return;
+    }
+    stream->inFlight++;
+    stream->offset += chunk;
   }
 
-  return result;
+  if ((stream->offset == stream->data.size()) && (stream->inFlight == 0)) {
+    stream->finish(false);
+  }
 }
 
 string BtleCommWrapper::readLine(int timeoutInMs) {
+  string result = "";
+  std::string_view line;
+  if (borrowLine(line, timeoutInMs) == true) {
+    result.append(line.data(), line.size());
+    releaseLine();
+  }
+  return result;
+}
+
+bool BtleCommWrapper::borrowLine(std::string_view& outLine, int timeoutInMs) {
   if (isConnected() == false) {
     printf("readLine: not connected, ignored!");
-    return "";
+    return false;
   }
 
-  string result = "";
+  //woken up by notificationEventsHandler
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(notificationMutex);
+  if (notificationCondition.wait_until(lock, startTime + std::chrono::milliseconds(timeoutInMs),
+      [this, &outLine]() {
+        return pendingRequests.empty() && notificationRing.borrowLine(outLine);
+      }) == false) {
+    printf("Read Timeout: %d ms\n", timeoutInMs);
+    lock.unlock();
+    checkCachedHandle(true);
+    return false;
+  }
+  return true;
+}
 
-  const int sleepTimeMs = 30;
-  gint64 startTime = g_get_monotonic_time();
-  timeoutInMs *= 1000;
+void BtleCommWrapper::releaseLine() {
+  //consumer side is shared with dispatchResponses()
+  std::lock_guard<std::mutex> guard(notificationMutex);
+  notificationRing.releaseLine();
+}
 
-  while (true) {
-    usleep(sleepTimeMs * 1000);
-    gint64 curTime = g_get_monotonic_time();
-    if (curTime - startTime > timeoutInMs) {
-      printf("Read Timeout: %lld, %lld, %lld\n", curTime - startTime, curTime, startTime);
-      break;
-    }
+LineRingBufferStats BtleCommWrapper::getNotificationStats() {
+  return notificationRing.getStats();
+}
+
+guint16 BtleCommWrapper::getMtu() {
+  g_mutex_lock(&mutex);
+  guint16 result = mtu;
+  g_mutex_unlock(&mutex);
+  return result;
+}
 
-    { //critical section
-      std::lock_guard<std::mutex> guard(notificationMutex);
-      if (notificationReceived == false) {
+BtleConnectionStats BtleCommWrapper::getStats() {
+  BtleConnectionStats result;
+  g_mutex_lock(&mutex);
+  result.address = address;
+  result.mtu = mtu;
+  g_mutex_unlock(&mutex);
+  result.notifications = notificationRing.getStats();
+  return result;
+}
+
+void BtleCommWrapper::sendRequest(const string& data, RequestCallback callback, int timeoutInMs) {
+  std::shared_ptr<PendingRequest> request = make_shared<PendingRequest>();
+  request->data = data;
+  request->callback = callback;
+
+  //GAttrib is used only from event loop thread, write is queued there
+  std::unique_lock<std::mutex> lock(notificationMutex);
+  //checked under lock, disconnect() clears attrib before it aborts requests, so none is left behind
+  if (isConnected() == false) {
+    lock.unlock();
+    g_warning("Not connected!");
+    callback(RequestResult{rsNotConnected, ""});
+    return;
+  }
+  request->id = nextRequestId++;
+  request->written = false;
+  request->writeSource = g_idle_add_full(G_PRIORITY_DEFAULT, BtleCommWrapper::requestWriteHandler,
+      new RequestRef(this, request->id), deleteRequestRef);
+  request->timeoutSource = g_timeout_add_full(G_PRIORITY_DEFAULT, timeoutInMs, BtleCommWrapper::requestTimeoutHandler,
+      new RequestRef(this, request->id), deleteRequestRef);
+  pendingRequests.push_back(request);
+}
+
+std::future<RequestResult> BtleCommWrapper::sendRequestAsync(const string& data, int timeoutInMs) {
+  std::shared_ptr<std::promise<RequestResult>> promise = make_shared<std::promise<RequestResult>>();
+  sendRequest(data, [promise](const RequestResult& result) {
+    promise->set_value(result);
+  }, timeoutInMs);
+  return promise->get_future();
+}
+
+gboolean BtleCommWrapper::requestWriteHandler(gpointer user_data) {
+  RequestRef* ref = static_cast<RequestRef*>(user_data);
+  ref->btleCom->writeRequests();
+  return false;
+}
+
+//Event loop thread. All requests not written yet go out in FIFO order, but none of them while
+//late response of expired request can come, it would be matched with wrong request.
+void BtleCommWrapper::writeRequests() {
+  std::vector<std::shared_ptr<PendingRequest>> writing;
+  {
+    std::lock_guard<std::mutex> guard(notificationMutex);
+    dropOverdueResponses();
+    if (owedResponses.empty() == false) {
+      //held until late responses come or grace period ends
+      scheduleOwedTimer();
+      return;
+    }
+    for (const std::shared_ptr<PendingRequest>& request : pendingRequests) {
+      if (request->written == true) {
         continue;
       }
-      std::vector<uint8_t>::iterator it = std::find_if(notificationBuffer->begin(), notificationBuffer->end(),
-          isItEnter);
-      if (it == notificationBuffer->end()) {
-        continue;
+      if (request->writeSource != 0) {
+        g_source_remove(request->writeSource);
+        request->writeSource = 0;
       }
+      request->written = true;
+      writing.push_back(request);
+    }
+  }
+  if (writing.empty() == true) {
+    return;
+  }
+
+  g_mutex_lock(&mutex);
+  GAttrib* attrib = g_attrib_ref(btleAttribute);
+  guint16 handle = btleValueHandle;
+  g_mutex_unlock(&mutex);
+
+  std::vector<std::shared_ptr<PendingRequest>> failed;
+  for (const std::shared_ptr<PendingRequest>& request : writing) {
+    RequestRef* writeRef = new RequestRef(this, request->id);
+    guint sent = 0;
+    if (attrib != nullptr && handle != 0 && request->data.empty() == false) {
+      size_t bufferSize;
+      uint8_t* buffer = g_attrib_get_buffer(attrib, &bufferSize);
+      if (request->data.size() <= bufferSize - WRITE_COMMAND_HEADER_SIZE) {
+        //GAttrib frees ref also when it's destroyed before response comes
+        guint16 plen = enc_write_req(handle, (uint8_t*) request->data.data(), request->data.size(), buffer,
+            bufferSize);
+        sent = g_attrib_send(attrib, 0, buffer, plen, BtleCommWrapper::requestWriteCallback, writeRef,
+            deleteRequestRef);
+      } else {
+        //long write has no destroy notify, ref is kept by wrapper until callback or disconnect()
+        {
+          std::lock_guard<std::mutex> guard(notificationMutex);
+          longWriteRefs[writeRef] = deleteRequestRef;
+        }
+        sent = gatt_write_char(attrib, handle, (uint8_t*) request->data.data(), request->data.size(),
+            BtleCommWrapper::requestLongWriteCallback, writeRef);
+        if (sent == 0) {
+          std::lock_guard<std::mutex> guard(notificationMutex);
+          longWriteRefs.erase(writeRef);
+        }
+      }
+    }
+    if (sent == 0) {
+      delete writeRef;
+      std::shared_ptr<PendingRequest> taken = takeRequest(request->id);
+      if (taken != nullptr) {
+        failed.push_back(taken);
+      }
+    }
+  }
+  g_attrib_unref(attrib);
+  for (const std::shared_ptr<PendingRequest>& request : failed) {
+    request->callback(RequestResult{rsWriteFailed, ""});
+  }
+}
+
+void BtleCommWrapper::requestWriteCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data) {
+  RequestRef* ref = static_cast<RequestRef*>(user_data);
+  if (status != 0 || (!dec_write_resp(pdu, plen) && !dec_exec_write_resp(pdu, plen))) {
+    g_warning("Request write failed: %s\n", att_ecode2str(status));
+    ref->btleCom->invalidateHandleCache();
+    //no response will come, so it doesn't take part in FIFO matching
+    std::shared_ptr<PendingRequest> request = ref->btleCom->takeRequest(ref->id);
+    if (request != nullptr) {
+      request->callback(RequestResult{rsWriteFailed, ""});
+    }
+  } else {
+    ref->btleCom->checkCachedHandle(false);
+  }
+}
+
+void BtleCommWrapper::requestLongWriteCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data) {
+  RequestRef* ref = static_cast<RequestRef*>(user_data);
+  requestWriteCallback(status, pdu, plen, user_data);
+  {
+    std::lock_guard<std::mutex> guard(ref->btleCom->notificationMutex);
+    ref->btleCom->longWriteRefs.erase(ref);
+  }
+  delete ref;
+}
+
+gboolean BtleCommWrapper::requestTimeoutHandler(gpointer user_data) {
+  RequestRef* ref = static_cast<RequestRef*>(user_data);
+  ref->btleCom->expireRequests(ref->id);
+  return false;
+}
+
+gboolean BtleCommWrapper::owedTimerHandler(gpointer user_data) {
+  BtleCommWrapper* btleCom = static_cast<BtleCommWrapper*>(user_data);
+  {
+    //removed by returning false, abortRequests() removes it on event loop thread too
+    std::lock_guard<std::mutex> guard(btleCom->notificationMutex);
+    btleCom->owedTimer = 0;
+  }
+  btleCom->writeRequests();
+  return false;
+}
+
+//Must be called with notificationMutex locked
+void BtleCommWrapper::dropOverdueResponses() {
+  gint64 now = g_get_monotonic_time();
+  for (auto it = owedResponses.begin(); it != owedResponses.end();) {
+    if (it->second <= now) {
+      printf("%s: no late response of request %llu\n", __func__, (unsigned long long) it->first);
+      it = owedResponses.erase(it);
+    } else {
       it++;
-      uint8_t* startAddress = &((*notificationBuffer)[0]);
-      size_t size = it - notificationBuffer->begin();
-      while (startAddress[size - 1] == '\r') {
-        size--;
+    }
+  }
+}
+
+//Must be called with notificationMutex locked
+void BtleCommWrapper::scheduleOwedTimer() {
+  if (owedTimer != 0 || owedResponses.empty() == true) {
+    return;
+  }
+  gint64 endTime = owedResponses.begin()->second;
+  for (auto& owed : owedResponses) {
+    endTime = MIN(endTime, owed.second);
+  }
+  gint64 delayInMs = MAX(0, (endTime - g_get_monotonic_time() + 999) / 1000);
+  owedTimer = g_timeout_add(delayInMs, BtleCommWrapper::owedTimerHandler, this);
+}
+
+std::shared_ptr<BtleCommWrapper::PendingRequest> BtleCommWrapper::takeRequest(guint64 id) {
+  std::lock_guard<std::mutex> guard(notificationMutex);
+  //expired request whose write failed, its late response won't come
+  owedResponses.erase(id);
+  for (auto it = pendingRequests.begin(); it != pendingRequests.end(); it++) {
+    if ((*it)->id == id) {
+      std::shared_ptr<PendingRequest> request = *it;
+      pendingRequests.erase(it);
+      if (request->writeSource != 0) {
+        g_source_remove(request->writeSource);
       }
-      if (size > 0) {
-        result.append((const char*) startAddress, size);
+      if (request->timeoutSource != 0) {
+        g_source_remove(request->timeoutSource);
       }
-      notificationBuffer->erase(notificationBuffer->begin(), it);
-      break;
+      return request;
     }
   }
-  return result;
+  return nullptr;
+}
+
+//Event loop thread, each complete line answers oldest written request
+void BtleCommWrapper::dispatchResponses() {
+  std::vector<std::pair<std::shared_ptr<PendingRequest>, string>> completed;
+  bool writeHeld = false;
+  {
+    std::lock_guard<std::mutex> guard(notificationMutex);
+    std::string_view line;
+    //late responses of expired requests come first, they would shift all later responses
+    bool owed = owedResponses.empty() == false;
+    dropOverdueResponses();
+    while (owedResponses.empty() == false && notificationRing.borrowLine(line) == true) {
+      printf("%s: late response of request %llu dropped\n", __func__,
+          (unsigned long long) owedResponses.begin()->first);
+      owedResponses.erase(owedResponses.begin());
+      notificationRing.releaseLine();
+    }
+    //everything owed is settled, held requests can go
+    writeHeld = owed == true && owedResponses.empty() == true;
+    while (pendingRequests.empty() == false && notificationRing.borrowLine(line) == true) {
+      std::shared_ptr<PendingRequest> request = pendingRequests.front();
+      if (request->written == false) {
+        //nothing was asked yet, so it's nobody's response
+        printf("%s: unsolicited line dropped\n", __func__);
+        notificationRing.releaseLine();
+        continue;
+      }
+      pendingRequests.pop_front();
+      if (request->timeoutSource != 0) {
+        g_source_remove(request->timeoutSource);
+      }
+      completed.push_back(make_pair(request, string(line)));
+      notificationRing.releaseLine();
+    }
+  }
+  if (writeHeld == true) {
+    writeRequests();
+  }
+  //callbacks are called without lock, so they can queue next requests
+  for (auto& response : completed) {
+    response.first->callback(RequestResult{rsSuccess, response.second});
+  }
+}
+
+//Event loop thread. Older requests are expired too, FIFO order can't be kept without them. Requests
+//which were already written can still be answered, their late responses are dropped in dispatchResponses()
+//within grace period, requests queued meanwhile are written after it.
+void BtleCommWrapper::expireRequests(guint64 id) {
+  std::vector<std::shared_ptr<PendingRequest>> expired;
+  {
+    std::lock_guard<std::mutex> guard(notificationMutex);
+    auto it = pendingRequests.begin();
+    for (; it != pendingRequests.end() && (*it)->id != id; it++) {
+    }
+    if (it == pendingRequests.end()) {
+      return;
+    }
+    (*it)->timeoutSource = 0;   //removed by returning false from handler
+    expired.assign(pendingRequests.begin(), it + 1);
+    pendingRequests.erase(pendingRequests.begin(), it + 1);
+    gint64 graceEndTime = g_get_monotonic_time() + LATE_RESPONSE_GRACE_MS * 1000;
+    for (const std::shared_ptr<PendingRequest>& request : expired) {
+      if (request->writeSource != 0) {
+        g_source_remove(request->writeSource);
+      }
+      if (request->written == true) {
+        //never written ones owe nothing
+        owedResponses[request->id] = graceEndTime;
+      }
+      if (request->timeoutSource != 0) {
+        g_source_remove(request->timeoutSource);
+      }
+    }
+    scheduleOwedTimer();
+  }
+  printf("%s: %zu request(s) timed out\n", __func__, expired.size());
+  checkCachedHandle(true);
+  for (const std::shared_ptr<PendingRequest>& request : expired) {
+    request->callback(RequestResult{rsTimeout, ""});
+  }
+}
+
+void BtleCommWrapper::abortRequests() {
+  std::deque<std::shared_ptr<PendingRequest>> aborted;
+  {
+    std::lock_guard<std::mutex> guard(notificationMutex);
+    aborted.swap(pendingRequests);
+    owedResponses.clear();
+    if (owedTimer != 0) {
+      g_source_remove(owedTimer);
+      owedTimer = 0;
+    }
+    for (const std::shared_ptr<PendingRequest>& request : aborted) {
+      if (request->writeSource != 0) {
+        g_source_remove(request->writeSource);
+      }
+      if (request->timeoutSource != 0) {
+        g_source_remove(request->timeoutSource);
+      }
+    }
+  }
+  for (const std::shared_ptr<PendingRequest>& request : aborted) {
+    request->callback(RequestResult{rsAborted, ""});
+  }
 }
@@ -16,6 +16,15 @@ extern "C" {
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <string_view>
+#include "LineRingBuffer.h"
 
 using namespace std;
 
@@ -30,6 +39,9 @@ enum ConnectionStatusState {
 
   cssFailedToConnect,
   cssConnectionEstablished,
+
+  cssBackoff,   //waiting for recovery timer, then connect starts again
+
 };
 
 enum NextAction {
@@ -38,44 +50,149 @@ enum NextAction {
   naFatal
 };
 
+enum SendMode {
+  smWriteRequest,   //each write is acknowledged by peer
+  smWriteCommand    //write without response, split into MTU sized chunks
+};
+
+enum RequestStatus {
+  rsSuccess,
+  rsNotConnected,
+  rsWriteFailed,
+  rsTimeout,    //also reported for all older requests, their responses can't be matched any more
+  rsAborted     //disconnected before response
+};
+
+struct RequestResult {
+  RequestStatus status;
+  string response;  //line without CR
+};
+
+struct BtleConnectionStats {
+  string address;
+  guint16 mtu;      //negotiated ATT MTU, 23 until exchange is done
+  LineRingBufferStats notifications;
+};
+
+//Called on event loop thread (on caller thread if not connected), must not block
+typedef std::function<void(const RequestResult& result)> RequestCallback;
+
+class WriteCommandStream;
+class RequestRef;
+class RecoveryTimer;
+class BtleCallbackData;
+
 class BtleCommWrapper {
   public:
+    //GLib callbacks are served by shared BtleReactor thread
     BtleCommWrapper();
     virtual ~BtleCommWrapper();
     bool connectTo(const string& address, gint64 timeoutInMs);
     bool isConnected();
     void disconnect();
-    bool send(const string& data, int timeoutInMs = 3000);
+    bool send(const string& data, int timeoutInMs = 3000, SendMode mode = smWriteRequest);
     string readLine(int timeoutInMs);
+    //Zero copy variant of readLine, line stays valid until releaseLine(). Lines have single reader,
+    //so readLine/borrowLine can't be called from more threads at once.
+    bool borrowLine(std::string_view& outLine, int timeoutInMs);
+    void releaseLine();
+    LineRingBufferStats getNotificationStats();
+    //ATT MTU of current connection, payload of single write/notification is 3 bytes smaller
+    guint16 getMtu();
+    BtleConnectionStats getStats();
+
+    //Pipelined requests, any number can be queued. Responses are matched in FIFO order, so
+    //readLine/borrowLine shouldn't be used while requests are pending. After a timeout, new
+    //requests are held for a short grace period, so late response of expired one isn't taken for theirs.
+    void sendRequest(const string& data, RequestCallback callback, int timeoutInMs = 3000);
+    std::future<RequestResult> sendRequestAsync(const string& data, int timeoutInMs = 3000);
   private:
+    struct PendingRequest {
+      guint64 id;
+      string data;
+      RequestCallback callback;
+      guint writeSource;    //idle source which writes pending requests
+      guint timeoutSource;
+      bool written;
+    };
+
     ConnectionStatusState state;
-    GMainLoop* eventLoop;
-    GThread* eventLoopThread;
     GIOChannel* btleChannel;
+    guint channelWatchSource;
     GAttrib* btleAttribute;
     guint16 btleValueHandle;
+    guint16 serviceChangedHandle;   //0 until indications of Service Changed are subscribed
+    guint16 mtu;
+    string address;
     std::mutex notificationMutex;
-    bool notificationReceived;
+    std::condition_variable notificationCondition;  //signalled on each notification
     GMutex mutex;
+    GCond stateCondition;   //signalled on each change of state or btleError
     int btleError;
-    std::shared_ptr<std::vector<uint8_t>> notificationBuffer;
+    LineRingBuffer notificationRing;    //written by event loop thread only
+    std::deque<std::shared_ptr<PendingRequest>> pendingRequests;    //guarded by notificationMutex
+    std::map<guint64, gint64> owedResponses;   //expired but written requests and monotonic end of grace
+                                               //period of their late response, guarded by notificationMutex
+    guint owedTimer;    //ends grace period, guarded by notificationMutex
+    //user data of long writes and its destroy function, gatt_write_char() has none, guarded by notificationMutex
+    std::map<gpointer, GDestroyNotify> longWriteRefs;
+    guint64 nextRequestId;
+    std::atomic<bool> cachedHandleUnverified;   //connected with cached handle, nothing confirmed it yet
+
+    guint recoveryTimer;
+    std::shared_ptr<RecoveryTimer> recoveryTarget;   //shared with recoveryTimer source, guarded by mutex
+    int recoveryAttempts;   //errors in current connectTo()
+    bool openCircuit;       //failure of current connectTo() opens circuit breaker at once
 
     void setBtleError(int error);
     bool isBtleError();
     NextAction handleBtleError();
+    void scheduleRecovery(int delayInMs);
+    void cancelRecovery();
+    static gboolean recoveryTimerHandler(gpointer user_data);
 
     void deleteBtleChannel();
     void deleteBtleAttrib();
+    void closeConnection();
+    void registerNotifications(GAttrib* attrib);
+    void subscribeServiceChanged();
+    void writeServiceChangedConfig(BtleCallbackData* callbackData, guint16 configHandle);
+    void invalidateHandleCache();
+    void checkCachedHandle(bool failed);
 
     bool isConnectingInProgress();
     ConnectionStatusState getState();
     void setState(ConnectionStatusState state);
+    bool waitForStateChange(ConnectionStatusState enterState, gint64 endTime);
 
     static void connectCallback(GIOChannel *io, GError *err, gpointer user_data);
     static void discoverCharacteristicCallback(GSList *characteristics, uint8_t status, void *user_data);
+    static void serviceChangedDiscoveredCallback(GSList *characteristics, uint8_t status, void *user_data);
+    static void serviceChangedDescriptorsCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+    static void serviceChangedSubscribedCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
     static void notificationEventsHandler(const uint8_t *pdu, uint16_t len, gpointer user_data);
     static gboolean channelWatch(GIOChannel* source, GIOCondition condition, gpointer data);
+    static void exchangeMtuCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+    static gboolean startWriteRequest(gpointer user_data);
     static void writeValueCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+    static void writeValueLongCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+    static gboolean startWriteCommands(gpointer user_data);
+    static void writeCommandSent(gpointer user_data);
+    static void pumpWriteCommands(const std::shared_ptr<WriteCommandStream>& stream);
+    bool sendWriteCommands(const string& data, int timeoutInMs);
+    static gboolean requestWriteHandler(gpointer user_data);
+    static gboolean requestTimeoutHandler(gpointer user_data);
+    static gboolean owedTimerHandler(gpointer user_data);
+    static void requestWriteCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+    static void requestLongWriteCallback(guint8 status, const guint8 *pdu, guint16 plen, gpointer user_data);
+
+    void writeRequests();
+    void dropOverdueResponses();
+    void scheduleOwedTimer();
+    void dispatchResponses();
+    void expireRequests(guint64 id);
+    void abortRequests();
+    std::shared_ptr<PendingRequest> takeRequest(guint64 id);
 
     void executeConnect(const string& address);
     void executeDiscovery(int timeoutInMs, gint64 startTime);
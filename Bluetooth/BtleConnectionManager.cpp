@@ -0,0 +1,355 @@
+/*
+ * BtleConnectionManager.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "BtleConnectionManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "BluetoothGuard.h"
+#include "BtleReactor.h"
+
+//how often idle links are checked
+static const int MAINTENANCE_INTERVAL_MS = 1000;
+static const int KEEPALIVE_TIMEOUT_MS = 3000;
+
+BtleConnectionManager::BtleConnectionManager(int maxLinks)
+: options{0, 0, "", 4000},
+  stopping(false) {
+
+  BluetoothGuard::setMaxLinks(maxLinks);
+  //reactor is kept running between links
+  BtleReactor::attach();
+  maintenanceThread = std::thread(&BtleConnectionManager::maintenanceLoop, this);
+}
+
+BtleConnectionManager::~BtleConnectionManager() {
+  std::map<string, ManagedLink> closing;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    stopping = true;
+  }
+  maintenanceCondition.notify_all();
+  maintenanceThread.join();
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    closing.swap(links);
+  }
+  //wrappers have to be disconnected while event loop still runs
+  for (auto& link : closing) {
+    link.second.wrapper->disconnect();
+  }
+  closing.clear();
+  BtleReactor::detach();
+}
+
+void BtleConnectionManager::setPersistentLinks(const PersistentLinkOptions& options) {
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    this->options = options;
+  }
+  maintenanceCondition.notify_all();
+}
+
+PersistentLinkOptions BtleConnectionManager::getPersistentLinks() {
+  std::lock_guard<std::mutex> guard(linksMutex);
+  return options;
+}
+
+std::shared_ptr<BtleCommWrapper> BtleConnectionManager::connect(const string& address, gint64 timeoutInMs) {
+  std::shared_ptr<BtleCommWrapper> link;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    auto it = links.find(address);
+    if (it != links.end()) {
+      //caller takes over link, it's not closed when idle
+      it->second.autoOpened = false;
+      link = it->second.wrapper;
+    } else {
+      //registered before connecting, so concurrent connect to the same address doesn't open second link
+      gint64 now = g_get_monotonic_time();
+      link = make_shared<BtleCommWrapper>();
+      links[address] = ManagedLink{link, 0, false, now, now, false};
+    }
+  }
+
+  if (connectLink(address, link, timeoutInMs) == true) {
+    return link;
+  }
+
+  std::lock_guard<std::mutex> guard(linksMutex);
+  auto it = links.find(address);
+  if (it != links.end() && it->second.wrapper == link && it->second.users == 0) {
+    links.erase(it);
+  }
+  return nullptr;
+}
+
+void BtleConnectionManager::release(const string& address) {
+  std::shared_ptr<BtleCommWrapper> link;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    auto it = links.find(address);
+    if (it == links.end()) {
+      return;
+    }
+    link = it->second.wrapper;
+    links.erase(it);
+  }
+  link->disconnect();
+}
+
+std::shared_ptr<BtleCommWrapper> BtleConnectionManager::getLink(const string& address) {
+  std::lock_guard<std::mutex> guard(linksMutex);
+  auto it = links.find(address);
+  if (it == links.end() || it->second.wrapper->isConnected() == false) {
+    return nullptr;
+  }
+  return it->second.wrapper;
+}
+
+std::vector<string> BtleConnectionManager::getConnectedAddresses() {
+  std::vector<string> result;
+  std::lock_guard<std::mutex> guard(linksMutex);
+  for (auto& link : links) {
+    if (link.second.wrapper->isConnected() == true) {
+      result.push_back(link.first);
+    }
+  }
+  return result;
+}
+
+int BtleConnectionManager::getMaxLinks() {
+  return BluetoothGuard::getMaxLinks();
+}
+
+RequestResult BtleConnectionManager::request(const string& address, const string& data, int requestTimeoutInMs) {
+  gint64 connectTimeoutInMs = getPersistentLinks().connectTimeoutInMs;
+  return requestOne(address, data, connectTimeoutInMs, requestTimeoutInMs);
+}
+
+RequestResult BtleConnectionManager::requestOne(const string& address, const string& data,
+    gint64 connectTimeoutInMs, int requestTimeoutInMs) {
+  RequestResult result{rsNotConnected, ""};
+  for (int attempt = 0; attempt < 2; attempt++) {
+    std::shared_ptr<BtleCommWrapper> link = useLink(address, connectTimeoutInMs);
+    if (link == nullptr) {
+      return RequestResult{rsNotConnected, ""};
+    }
+    result = link->sendRequestAsync(data, requestTimeoutInMs).get();
+    unuseLink(address, link);
+    if (result.status != rsAborted && result.status != rsNotConnected) {
+      break;
+    }
+    printf("%s: link to %s dropped, reconnecting\n", __func__, address.c_str());
+  }
+  return result;
+}
+
+//Link marked as used can't be closed as idle or evicted
+std::shared_ptr<BtleCommWrapper> BtleConnectionManager::useLink(const string& address, gint64 connectTimeoutInMs) {
+  std::shared_ptr<BtleCommWrapper> link;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    gint64 now = g_get_monotonic_time();
+    auto it = links.find(address);
+    if (it == links.end()) {
+      it = links.insert(make_pair(address, ManagedLink{make_shared<BtleCommWrapper>(), 0, true, now, now, false})).first;
+    }
+    it->second.users++;
+    it->second.lastUsed = now;
+    link = it->second.wrapper;
+  }
+
+  //dropped links (HUP) are reconnected lazily here
+  if (connectLink(address, link, connectTimeoutInMs) == true) {
+    return link;
+  }
+
+  std::lock_guard<std::mutex> guard(linksMutex);
+  auto it = links.find(address);
+  if (it != links.end() && it->second.wrapper == link) {
+    it->second.users--;
+    if (it->second.users == 0 && it->second.autoOpened == true) {
+      links.erase(it);
+    }
+  }
+  return nullptr;
+}
+
+//Only one caller connects the link, concurrent ones wait for its result instead of failing in connectTo()
+bool BtleConnectionManager::connectLink(const string& address, const std::shared_ptr<BtleCommWrapper>& link,
+    gint64 timeoutInMs) {
+  std::unique_lock<std::mutex> lock(linksMutex);
+  auto endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutInMs);
+  auto it = links.find(address);
+  if (it != links.end() && it->second.wrapper == link && it->second.connecting == true) {
+    connectCondition.wait_until(lock, endTime, [this, &address, &link]() {
+      auto it = links.find(address);
+      return it == links.end() || it->second.wrapper != link || it->second.connecting == false;
+    });
+    //result of the other attempt is taken as it is
+    return link->isConnected();
+  }
+  if (link->isConnected() == true) {
+    return true;
+  }
+  if (it == links.end() || it->second.wrapper != link) {
+    //released meanwhile
+    return false;
+  }
+  it->second.connecting = true;
+  lock.unlock();
+
+  evictIdleLink(address);
+  bool result = link->connectTo(address, timeoutInMs);
+
+  lock.lock();
+  it = links.find(address);
+  if (it != links.end() && it->second.wrapper == link) {
+    it->second.connecting = false;
+  }
+  lock.unlock();
+  connectCondition.notify_all();
+  return result;
+}
+
+void BtleConnectionManager::unuseLink(const string& address, const std::shared_ptr<BtleCommWrapper>& link) {
+  bool close = false;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    auto it = links.find(address);
+    if (it == links.end() || it->second.wrapper != link) {
+      //released meanwhile
+      return;
+    }
+    it->second.users--;
+    it->second.lastUsed = g_get_monotonic_time();
+    close = it->second.users == 0 && it->second.autoOpened == true && options.idleTimeoutInMs == 0;
+    if (close == true) {
+      links.erase(it);
+    }
+  }
+  if (close == true) {
+    //frees link slot for next device
+    link->disconnect();
+  }
+}
+
+//Closes least recently used idle link when all slots are taken
+void BtleConnectionManager::evictIdleLink(const string& exceptAddress) {
+  std::shared_ptr<BtleCommWrapper> evicted;
+  {
+    std::lock_guard<std::mutex> guard(linksMutex);
+    int connected = 0;
+    auto oldest = links.end();
+    for (auto it = links.begin(); it != links.end(); it++) {
+      if (it->second.wrapper->isConnected() == false) {
+        continue;
+      }
+      connected++;
+      if (it->first != exceptAddress && it->second.users == 0 && it->second.autoOpened == true &&
+          (oldest == links.end() || it->second.lastUsed < oldest->second.lastUsed)) {
+        oldest = it;
+      }
+    }
+    if (connected < BluetoothGuard::getMaxLinks() || oldest == links.end()) {
+      return;
+    }
+    printf("%s: closing idle link to %s\n", __func__, oldest->first.c_str());
+    evicted = oldest->second.wrapper;
+    links.erase(oldest);
+  }
+  evicted->disconnect();
+}
+
+//Closes idle links after idle timeout and sends keepalive to the others
+void BtleConnectionManager::maintenanceLoop() {
+  std::unique_lock<std::mutex> lock(linksMutex);
+  while (stopping == false) {
+    maintenanceCondition.wait_for(lock, std::chrono::milliseconds(MAINTENANCE_INTERVAL_MS), [this]() {
+      return stopping;
+    });
+    if (stopping == true) {
+      break;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    std::vector<std::shared_ptr<BtleCommWrapper>> idle;
+    std::vector<std::pair<string, std::shared_ptr<BtleCommWrapper>>> keepalive;
+    for (auto it = links.begin(); it != links.end();) {
+      ManagedLink& link = it->second;
+      if (link.users != 0) {
+        it++;
+        continue;
+      }
+      if (link.autoOpened == true && (link.wrapper->isConnected() == false ||
+          (options.idleTimeoutInMs > 0 && now - link.lastUsed >= (gint64) options.idleTimeoutInMs * 1000))) {
+        //dropped links are forgotten, next request() reconnects
+        idle.push_back(link.wrapper);
+        it = links.erase(it);
+        continue;
+      }
+      if (options.keepaliveIntervalInMs > 0 && options.keepaliveData.empty() == false &&
+          link.wrapper->isConnected() == true &&
+          now - MAX(link.lastUsed, link.lastKeepalive) >= (gint64) options.keepaliveIntervalInMs * 1000) {
+        //in flight keepalive keeps link from being closed as idle or evicted
+        link.users++;
+        link.lastKeepalive = now;
+        keepalive.push_back(make_pair(it->first, link.wrapper));
+      }
+      it++;
+    }
+    string keepaliveData = options.keepaliveData;
+    lock.unlock();
+
+    for (std::shared_ptr<BtleCommWrapper>& link : idle) {
+      link->disconnect();
+    }
+    for (auto& link : keepalive) {
+      //write command has no response, so nothing is owed to FIFO matching of requests
+      if (link.second->send(keepaliveData, KEEPALIVE_TIMEOUT_MS, smWriteCommand) == false) {
+        printf("%s: keepalive of %s failed\n", __func__, link.first.c_str());
+      }
+    }
+    idle.clear();
+    lock.lock();
+    for (auto& link : keepalive) {
+      auto it = links.find(link.first);
+      if (it != links.end() && it->second.wrapper == link.second) {
+        it->second.users--;
+      }
+    }
+    keepalive.clear();
+  }
+}
+
+std::map<string, RequestResult> BtleConnectionManager::requestAll(const std::vector<string>& addresses,
+    const string& data, gint64 connectTimeoutInMs, int requestTimeoutInMs) {
+  std::map<string, RequestResult> results;
+  std::mutex resultsMutex;
+  std::atomic<size_t> nextAddress(0);
+
+  //connectTo() blocks, so each concurrently served device needs its own worker. Workers just wait,
+  //all GATT traffic goes through reactor thread.
+  size_t workersCount = std::min(addresses.size(), (size_t) getMaxLinks());
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < workersCount; t++) {
+    workers.push_back(std::thread([&]() {
+      for (size_t index = nextAddress++; index < addresses.size(); index = nextAddress++) {
+        RequestResult result = requestOne(addresses[index], data, connectTimeoutInMs, requestTimeoutInMs);
+        std::lock_guard<std::mutex> guard(resultsMutex);
+        results[addresses[index]] = result;
+      }
+    }));
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  return results;
+}
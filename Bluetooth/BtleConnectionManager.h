@@ -0,0 +1,82 @@
+/*
+ * BtleConnectionManager.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef BtleConnectionManager_hpp
+#define BtleConnectionManager_hpp
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "BtleCommWrapper.h"
+
+struct PersistentLinkOptions {
+  int idleTimeoutInMs;        //0 - links opened by request() are closed right after response
+  int keepaliveIntervalInMs;  //0 - no keepalive, idle link is left to link supervision
+  string keepaliveData;       //written to idle link as write command, peer mustn't answer it
+  gint64 connectTimeoutInMs;
+};
+
+//Owns links to many devices, all of them are served by BtleReactor thread.
+//Number of concurrently open links is limited by BluetoothGuard, connecting waits for free slot.
+class BtleConnectionManager {
+  public:
+    BtleConnectionManager(int maxLinks = 4);
+    virtual ~BtleConnectionManager();
+
+    //Persistent mode keeps links opened by request() up to idle timeout. When all slots are taken,
+    //least recently used idle link is closed to make room for new device.
+    void setPersistentLinks(const PersistentLinkOptions& options);
+    PersistentLinkOptions getPersistentLinks();
+
+    //Cheapest path to device: open link is reused, otherwise it's (re)connected. Request interrupted
+    //by disconnect (HUP) is repeated once on new connection.
+    RequestResult request(const string& address, const string& data, int requestTimeoutInMs = 3000);
+
+    //connected link or nullptr, already open link is returned as it is
+    std::shared_ptr<BtleCommWrapper> connect(const string& address, gint64 timeoutInMs);
+    //disconnects, link can still be used by holders of shared_ptr, but it's not connected any more
+    void release(const string& address);
+    std::shared_ptr<BtleCommWrapper> getLink(const string& address);
+    std::vector<string> getConnectedAddresses();
+
+    //Sends data as request to each device and waits for all responses. Up to maxLinks devices are
+    //served at once, links opened here are closed afterwards unless persistent mode is on.
+    //connectTo() blocks its caller, so each served device has worker thread which only waits,
+    //GATT traffic of all of them goes through reactor thread.
+    std::map<string, RequestResult> requestAll(const std::vector<string>& addresses, const string& data,
+        gint64 connectTimeoutInMs, int requestTimeoutInMs = 3000);
+
+    int getMaxLinks();
+  private:
+    struct ManagedLink {
+      std::shared_ptr<BtleCommWrapper> wrapper;
+      int users;            //requests in progress, keepalive included
+      bool autoOpened;      //opened by request(), not by connect()
+      gint64 lastUsed;      //monotonic time of last request
+      gint64 lastKeepalive;
+      bool connecting;      //connectTo() in progress, other users wait for it
+    };
+
+    std::mutex linksMutex;
+    std::condition_variable maintenanceCondition;
+    std::condition_variable connectCondition;   //signalled when connecting of any link ends
+    std::map<string, ManagedLink> links;   //guarded by linksMutex
+    PersistentLinkOptions options;         //guarded by linksMutex
+    bool stopping;
+    std::thread maintenanceThread;
+
+    RequestResult requestOne(const string& address, const string& data, gint64 connectTimeoutInMs,
+        int requestTimeoutInMs);
+    std::shared_ptr<BtleCommWrapper> useLink(const string& address, gint64 connectTimeoutInMs);
+    bool connectLink(const string& address, const std::shared_ptr<BtleCommWrapper>& link, gint64 timeoutInMs);
+    void unuseLink(const string& address, const std::shared_ptr<BtleCommWrapper>& link);
+    void evictIdleLink(const string& exceptAddress);
+    void maintenanceLoop();
+};
+
+#endif /* BtleConnectionManager_hpp */
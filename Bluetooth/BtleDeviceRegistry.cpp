@@ -0,0 +1,85 @@
+/*
+ * BtleDeviceRegistry.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "BtleDeviceRegistry.h"
+
+BTLEDevice::BTLEDevice(std::string address, std::string name)
+: address(address), name(name), key(0), addressType(0), rssi(0), lastSeen(0) {
+}
+
+BTLEDevice::BTLEDevice(const BTLEDevice& source)
+: address(source.address), name(source.name), key(source.key), addressType(source.addressType),
+  rssi(source.rssi), lastSeen(source.lastSeen), manufacturerData(source.manufacturerData) {
+}
+
+bool BTLEDevice::operator ==(const BTLEDevice& rhs) {
+    return address == rhs.address;
+}
+
+BtleDeviceRegistry::BtleDeviceRegistry()
+: changed(false), snapshot(std::make_shared<const BTLEDeviceList>()) {
+}
+
+uint64_t BtleDeviceRegistry::addressToKey(const bdaddr_t& address) {
+    uint64_t key = 0;
+    for (int i = 5; i >= 0; i--) {
+        key = (key << 8) | address.b[i];
+    }
+    return key;
+}
+
+BTLEDevice& BtleDeviceRegistry::touch(const bdaddr_t& address, uint8_t addressType, int8_t rssi, int64_t now,
+        bool& isNew) {
+    uint64_t key = addressToKey(address);
+    auto it = devices.find(key);
+    isNew = it == devices.end();
+    if (isNew == true) {
+        //string form is made once per device
+        char addr[19];
+        ba2str(&address, addr);
+        it = devices.emplace(key, BTLEDevice(addr, "")).first;
+        it->second.key = key;
+    }
+    BTLEDevice& device = it->second;
+    device.addressType = addressType;
+    device.rssi = rssi;
+    device.lastSeen = now;
+    changed = true;
+    return device;
+}
+
+BTLEDevice* BtleDeviceRegistry::find(uint64_t key) {
+    auto it = devices.find(key);
+    return it == devices.end() ? nullptr : &it->second;
+}
+
+void BtleDeviceRegistry::markChanged() {
+    changed = true;
+}
+
+void BtleDeviceRegistry::publish() {
+    if (changed == false) {
+        return;
+    }
+    std::shared_ptr<BTLEDeviceList> list = std::make_shared<BTLEDeviceList>();
+    list->reserve(devices.size());
+    for (auto& device : devices) {
+        list->push_back(device.second);
+    }
+    std::atomic_store(&snapshot, std::shared_ptr<const BTLEDeviceList>(list));
+    changed = false;
+}
+
+void BtleDeviceRegistry::clear() {
+    devices.clear();
+    changed = true;
+    publish();
+}
+
+std::shared_ptr<const BTLEDeviceList> BtleDeviceRegistry::getSnapshot() const {
+    return std::atomic_load(&snapshot);
+}
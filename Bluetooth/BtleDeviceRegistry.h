@@ -0,0 +1,60 @@
+/*
+ * BtleDeviceRegistry.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef BtleDeviceRegistry_hpp
+#define BtleDeviceRegistry_hpp
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <bluetooth/bluetooth.h>
+
+class BTLEDevice {
+    public:
+        std::string address;
+        std::string name;
+        uint64_t key;           //48-bit address as integer
+        uint8_t addressType;    //LE_PUBLIC_ADDRESS or LE_RANDOM_ADDRESS
+        int8_t rssi;            //of last report, dBm
+        int64_t lastSeen;       //monotonic time of last report, ms
+        std::vector<uint8_t> manufacturerData;  //raw payload of last manufacturer specific AD, with company id
+        bool operator ==(const BTLEDevice& rhs);
+
+        BTLEDevice(std::string address, std::string name);
+        BTLEDevice(const BTLEDevice& source);
+};
+
+typedef std::vector<BTLEDevice> BTLEDeviceList;
+
+//Devices seen by scanner, keyed by address. Updated by scan thread only, other threads read
+//immutable snapshots which are republished by publish() when something changed.
+class BtleDeviceRegistry {
+    public:
+        BtleDeviceRegistry();
+
+        static uint64_t addressToKey(const bdaddr_t& address);
+
+        //scan thread, creates device on first report, isNew is set for it
+        BTLEDevice& touch(const bdaddr_t& address, uint8_t addressType, int8_t rssi, int64_t now, bool& isNew);
+        BTLEDevice* find(uint64_t key);
+        void markChanged();
+        //scan thread, snapshot is rebuilt only if registry changed since last publish
+        void publish();
+        void clear();
+
+        //lock free, snapshot is never modified
+        std::shared_ptr<const BTLEDeviceList> getSnapshot() const;
+
+    private:
+        std::unordered_map<uint64_t, BTLEDevice> devices;
+        bool changed;
+        std::shared_ptr<const BTLEDeviceList> snapshot;   //accessed by std::atomic_load/atomic_store only
+};
+
+#endif /* BtleDeviceRegistry_hpp */
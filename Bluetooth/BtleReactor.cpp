@@ -0,0 +1,128 @@
+/*
+ * BtleReactor.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include <stdio.h>
+#include <condition_variable>
+#include "BtleReactor.h"
+
+static const char* THREAD_NAME = "BtleCom";
+//time for which idle reactor is kept running
+static const guint REACTOR_LINGER_MS = 5000;
+
+//Function passed to reactor thread by invoke(), lives on stack of waiting caller
+class ReactorCall {
+  public:
+    const std::function<void()>& function;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done;
+
+    ReactorCall(const std::function<void()>& function)
+    : function(function), done(false) {
+
+    }
+};
+
+std::mutex BtleReactor::innerMutex;
+GMainLoop* BtleReactor::eventLoop = nullptr;
+GThread* BtleReactor::eventLoopThread = nullptr;
+int BtleReactor::references = 0;
+guint BtleReactor::lingerTimer = 0;
+guint BtleReactor::lingerGeneration = 0;
+
+gpointer BtleReactor::threadMain(gpointer data) {
+  GMainLoop* loop = static_cast<GMainLoop*>(data);
+  printf("BTLE thread start\n");
+  g_main_loop_run(loop);
+  g_main_loop_unref(loop);
+  printf("BTLE thread loop end\n");
+  return nullptr;
+}
+
+void BtleReactor::attach() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  references++;
+  //linger of previous idle period is over, timer may already be dispatched, so it's invalidated too
+  lingerGeneration++;
+  if (lingerTimer != 0) {
+    g_source_remove(lingerTimer);
+    lingerTimer = 0;
+  }
+  if (eventLoop == nullptr) {
+    eventLoop = g_main_loop_new(nullptr, false);
+    //thread keeps its own reference of loop
+    eventLoopThread = g_thread_new(THREAD_NAME, &BtleReactor::threadMain, g_main_loop_ref(eventLoop));
+  }
+}
+
+void BtleReactor::detach() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  if (references <= 0) {
+    printf("%s: reactor is not attached\n", __func__);
+    return;
+  }
+  references--;
+  if (references == 0) {
+    //stopped from loop itself, so detach() never joins and can be called from reactor thread
+    lingerGeneration++;
+    lingerTimer = g_timeout_add(REACTOR_LINGER_MS, &BtleReactor::lingerTimeout, GUINT_TO_POINTER(lingerGeneration));
+  }
+}
+
+gboolean BtleReactor::lingerTimeout(gpointer data) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  if (GPOINTER_TO_UINT(data) != lingerGeneration) {
+    //attached again meanwhile
+    return false;
+  }
+  lingerTimer = 0;
+  if (references == 0 && eventLoop != nullptr) {
+    g_main_loop_quit(eventLoop);
+    g_main_loop_unref(eventLoop);
+    g_thread_unref(eventLoopThread);
+    eventLoop = nullptr;
+    eventLoopThread = nullptr;
+  }
+  return false;
+}
+
+bool BtleReactor::isReactorThread() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  return eventLoopThread != nullptr && eventLoopThread == g_thread_self();
+}
+
+void BtleReactor::invoke(const std::function<void()>& function) {
+  bool runHere;
+  {
+    std::lock_guard<std::mutex> guard(innerMutex);
+    //nothing else runs GLib callbacks without reactor
+    runHere = eventLoopThread == nullptr || eventLoopThread == g_thread_self();
+  }
+  if (runHere == true) {
+    function();
+    return;
+  }
+  ReactorCall call(function);
+  g_idle_add(&BtleReactor::invokeHandler, &call);
+  std::unique_lock<std::mutex> lock(call.mutex);
+  call.condition.wait(lock, [&call]() { return call.done; });
+}
+
+gboolean BtleReactor::invokeHandler(gpointer data) {
+  ReactorCall* call = static_cast<ReactorCall*>(data);
+  call->function();
+  //notified under lock, caller's stack frame is gone right after it sees done
+  std::lock_guard<std::mutex> guard(call->mutex);
+  call->done = true;
+  call->condition.notify_all();
+  return false;
+}
+
+int BtleReactor::getReferences() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  return references;
+}
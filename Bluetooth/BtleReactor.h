@@ -0,0 +1,43 @@
+/*
+ * BtleReactor.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef BtleReactor_hpp
+#define BtleReactor_hpp
+
+extern "C" {
+    #include "glib-2.0/glib.h"
+}
+#include <mutex>
+#include <functional>
+
+//Process wide GLib event loop thread running default main context, which is used by libgatt.
+//Started by first attach(), stopped when nobody is attached for REACTOR_LINGER_MS, so links
+//created and destroyed in each poll cycle don't spawn new thread.
+class BtleReactor {
+  public:
+    static void attach();
+    static void detach();
+    static bool isReactorThread();
+    //Runs function on reactor thread and waits for it, called from reactor thread it runs at once.
+    //Caller mustn't hold locks which reactor callbacks take.
+    static void invoke(const std::function<void()>& function);
+    static int getReferences();
+
+  private:
+    static std::mutex innerMutex;
+    static GMainLoop* eventLoop;
+    static GThread* eventLoopThread;
+    static int references;
+    static guint lingerTimer;
+    static guint lingerGeneration;   //changed by each attach/detach, older linger timer is ignored
+
+    static gpointer threadMain(gpointer data);
+    static gboolean lingerTimeout(gpointer data);
+    static gboolean invokeHandler(gpointer data);
+};
+
+#endif /* BtleReactor_hpp */
@@ -0,0 +1,120 @@
+/*
+ * BtleRecovery.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include <stdio.h>
+#include "BtleRecovery.h"
+
+std::mutex BtleRecoveryPolicy::innerMutex;
+std::map<int, RetryPolicy> BtleRecoveryPolicy::policies = {
+  //resource busy, controller is stuck
+  {16,  RetryPolicy{raRestartAdapter, 3000, 12000, 3, false}},
+  //operation aborted
+  {130, RetryPolicy{raRetry, 3000, 12000, 5, false}},
+  //host is unreachable
+  {148, RetryPolicy{raFail, 0, 0, 0, true}},
+};
+RetryPolicy BtleRecoveryPolicy::defaultPolicy = RetryPolicy{raRetry, 1000, 8000, 5, false};
+
+void BtleRecoveryPolicy::setPolicy(int errorCode, const RetryPolicy& policy) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  policies[errorCode] = policy;
+}
+
+void BtleRecoveryPolicy::setDefaultPolicy(const RetryPolicy& policy) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  defaultPolicy = policy;
+}
+
+RetryPolicy BtleRecoveryPolicy::getPolicy(int errorCode) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = policies.find(errorCode);
+  return it != policies.end() ? it->second : defaultPolicy;
+}
+
+int BtleRecoveryPolicy::getRetryDelayInMs(const RetryPolicy& policy, int attempt) {
+  gint64 delay = policy.baseDelayInMs;
+  for (int t = 1; t < attempt && delay < policy.maxDelayInMs; t++) {
+    delay *= 2;
+  }
+  delay = MIN(delay, (gint64) policy.maxDelayInMs);
+  if (delay < 2) {
+    return (int) delay;
+  }
+  //jitter, so links failed by the same event don't retry at once
+  return (int) (delay / 2 + g_random_int_range(0, (gint32) (delay / 2) + 1));
+}
+
+std::mutex BtleCircuitBreaker::innerMutex;
+std::map<std::string, BtleCircuitBreaker::Circuit> BtleCircuitBreaker::circuits;
+int BtleCircuitBreaker::failureThreshold = 3;
+int BtleCircuitBreaker::openTimeInMs = 30000;
+int BtleCircuitBreaker::maxOpenTimeInMs = 600000;
+
+void BtleCircuitBreaker::configure(int failureThreshold, int openTimeInMs, int maxOpenTimeInMs) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  BtleCircuitBreaker::failureThreshold = failureThreshold;
+  BtleCircuitBreaker::openTimeInMs = openTimeInMs;
+  BtleCircuitBreaker::maxOpenTimeInMs = maxOpenTimeInMs;
+}
+
+bool BtleCircuitBreaker::allowAttempt(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = circuits.find(address);
+  if (it == circuits.end() || it->second.openUntil == 0) {
+    return true;
+  }
+  Circuit& circuit = it->second;
+  if (circuit.probing == true || g_get_monotonic_time() < circuit.openUntil) {
+    return false;
+  }
+  //half open
+  circuit.probing = true;
+  return true;
+}
+
+void BtleCircuitBreaker::abandonAttempt(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = circuits.find(address);
+  if (it != circuits.end()) {
+    it->second.probing = false;
+  }
+}
+
+void BtleCircuitBreaker::recordSuccess(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  circuits.erase(address);
+}
+
+void BtleCircuitBreaker::recordFailure(const std::string& address, bool openNow) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = circuits.find(address);
+  if (it == circuits.end()) {
+    it = circuits.insert(std::make_pair(address, Circuit{0, openTimeInMs, 0, false})).first;
+  }
+  Circuit& circuit = it->second;
+  circuit.failures++;
+  if (circuit.probing == true) {
+    //probe failed, stay open longer
+    circuit.openTimeInMs = MIN(circuit.openTimeInMs * 2, maxOpenTimeInMs);
+    circuit.probing = false;
+  } else if (openNow == false && circuit.failures < failureThreshold) {
+    return;
+  }
+  circuit.openUntil = g_get_monotonic_time() + (gint64) circuit.openTimeInMs * 1000;
+  printf("%s: circuit of %s open for %d ms\n", __func__, address.c_str(), circuit.openTimeInMs);
+}
+
+bool BtleCircuitBreaker::isOpen(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = circuits.find(address);
+  return it != circuits.end() && it->second.openUntil != 0 && g_get_monotonic_time() < it->second.openUntil;
+}
+
+void BtleCircuitBreaker::reset(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  circuits.erase(address);
+}
@@ -0,0 +1,76 @@
+/*
+ * BtleRecovery.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef BtleRecovery_hpp
+#define BtleRecovery_hpp
+
+extern "C" {
+    #include "glib-2.0/glib.h"
+}
+#include <string>
+#include <map>
+#include <mutex>
+
+enum RecoveryAction {
+  raRetry,
+  raRestartAdapter,   //HCI down/up before retry, it breaks all other links too
+  raFail
+};
+
+struct RetryPolicy {
+  RecoveryAction action;
+  int baseDelayInMs;  //delay before first retry, doubled with each next one
+  int maxDelayInMs;
+  int maxAttempts;    //per connectTo(), then error is fatal
+  bool opensCircuit;  //device is not tried again until circuit breaker closes
+};
+
+//Retry policies by error code (errno or ATT status), process wide
+class BtleRecoveryPolicy {
+  public:
+    static void setPolicy(int errorCode, const RetryPolicy& policy);
+    static void setDefaultPolicy(const RetryPolicy& policy);
+    static RetryPolicy getPolicy(int errorCode);
+    //exponential backoff with jitter, delay is random from <delay/2, delay>
+    static int getRetryDelayInMs(const RetryPolicy& policy, int attempt);
+
+  private:
+    static std::mutex innerMutex;
+    static std::map<int, RetryPolicy> policies;
+    static RetryPolicy defaultPolicy;
+};
+
+//Per device circuit breaker. Opened after failureThreshold failed connects in row (or at once by error
+//with opensCircuit), while open connectTo fails immediately. After open time single attempt is let through,
+//its success closes circuit, failure opens it again for twice as long.
+class BtleCircuitBreaker {
+  public:
+    static void configure(int failureThreshold, int openTimeInMs, int maxOpenTimeInMs);
+    static bool allowAttempt(const std::string& address);
+    //attempt allowed by allowAttempt() wasn't made (no free link...)
+    static void abandonAttempt(const std::string& address);
+    static void recordSuccess(const std::string& address);
+    static void recordFailure(const std::string& address, bool openNow = false);
+    static bool isOpen(const std::string& address);
+    static void reset(const std::string& address);
+
+  private:
+    struct Circuit {
+      int failures;
+      int openTimeInMs;
+      gint64 openUntil;   //monotonic time, 0 when closed
+      bool probing;       //half open, one attempt is in progress
+    };
+
+    static std::mutex innerMutex;
+    static std::map<std::string, Circuit> circuits;
+    static int failureThreshold;
+    static int openTimeInMs;
+    static int maxOpenTimeInMs;
+};
+
+#endif /* BtleRecovery_hpp */
@@ -0,0 +1,119 @@
+/*
+ * GattHandleCache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include <stdio.h>
+#include "GattHandleCache.h"
+
+std::mutex GattHandleCache::innerMutex;
+std::string GattHandleCache::storePath;
+bool GattHandleCache::dirty = false;
+std::map<std::pair<std::string, std::string>, uint16_t> GattHandleCache::handles;
+
+void GattHandleCache::setStorePath(const std::string& path) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  storePath = path;
+  handles.clear();
+  dirty = false;
+  load();
+}
+
+std::string GattHandleCache::getStorePath() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  return storePath;
+}
+
+void GattHandleCache::flush() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  if (dirty == true) {
+    save();
+    dirty = false;
+  }
+}
+
+bool GattHandleCache::lookup(const std::string& address, const std::string& uuid, uint16_t& outHandle) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  auto it = handles.find(std::make_pair(address, uuid));
+  if (it == handles.end()) {
+    return false;
+  }
+  outHandle = it->second;
+  return true;
+}
+
+void GattHandleCache::store(const std::string& address, const std::string& uuid, uint16_t handle) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  uint16_t& cached = handles[std::make_pair(address, uuid)];
+  if (cached != handle) {
+    cached = handle;
+    dirty = true;
+  }
+}
+
+void GattHandleCache::invalidate(const std::string& address) {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  bool changed = false;
+  for (auto it = handles.begin(); it != handles.end();) {
+    if (it->first.first == address) {
+      it = handles.erase(it);
+      changed = true;
+    } else {
+      it++;
+    }
+  }
+  if (changed == true) {
+    printf("%s: handles of %s invalidated\n", __func__, address.c_str());
+    dirty = true;
+  }
+}
+
+void GattHandleCache::clear() {
+  std::lock_guard<std::mutex> guard(innerMutex);
+  handles.clear();
+  dirty = true;
+}
+
+//must be called with innerMutex locked
+void GattHandleCache::load() {
+  if (storePath.empty() == true) {
+    return;
+  }
+  FILE* file = fopen(storePath.c_str(), "r");
+  if (file == nullptr) {
+    //no cache yet
+    return;
+  }
+  char address[32];
+  char uuid[64];
+  unsigned int handle = 0;
+  while (fscanf(file, "%31s %63s %x", address, uuid, &handle) == 3) {
+    if (handle != 0 && handle <= 0xffff) {
+      handles[std::make_pair(std::string(address), std::string(uuid))] = (uint16_t) handle;
+    }
+  }
+  fclose(file);
+}
+
+//must be called with innerMutex locked, whole file is rewritten, it holds only few entries
+void GattHandleCache::save() {
+  if (storePath.empty() == true) {
+    return;
+  }
+  std::string tmpPath = storePath + ".tmp";
+  FILE* file = fopen(tmpPath.c_str(), "w");
+  if (file == nullptr) {
+    printf("%s: can't write %s\n", __func__, tmpPath.c_str());
+    return;
+  }
+  for (auto& entry : handles) {
+    fprintf(file, "%s %s 0x%04x\n", entry.first.first.c_str(), entry.first.second.c_str(), entry.second);
+  }
+  fclose(file);
+  //readers never see half written file
+  if (rename(tmpPath.c_str(), storePath.c_str()) != 0) {
+    printf("%s: can't replace %s\n", __func__, storePath.c_str());
+  }
+}
@@ -0,0 +1,44 @@
+/*
+ * GattHandleCache.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef GattHandleCache_hpp
+#define GattHandleCache_hpp
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <mutex>
+
+//Process wide cache of characteristic value handles keyed by device address and characteristic UUID.
+//Persistence is opt-in: with store path set, entries are kept in text file (one "address uuid handle"
+//per line), so handles survive restarts.
+class GattHandleCache {
+  public:
+    //file is loaded at once, empty path (default) keeps cache in memory only
+    static void setStorePath(const std::string& path);
+    static std::string getStorePath();
+    //writes changes to store file. store() and invalidate() are called on reactor thread, so they
+    //never touch the file themselves, flush() is called from caller threads instead.
+    static void flush();
+
+    static bool lookup(const std::string& address, const std::string& uuid, uint16_t& outHandle);
+    static void store(const std::string& address, const std::string& uuid, uint16_t handle);
+    //all handles of device, called when they could be wrong (write failed, services changed)
+    static void invalidate(const std::string& address);
+    static void clear();
+
+  private:
+    static std::mutex innerMutex;
+    static std::string storePath;
+    static bool dirty;    //changed since last flush()
+    static std::map<std::pair<std::string, std::string>, uint16_t> handles;
+
+    static void load();
+    static void save();
+};
+
+#endif /* GattHandleCache_hpp */
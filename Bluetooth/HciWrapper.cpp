@@ -6,7 +6,9 @@
  */
 #include "HciWrapper.hpp"
 #include <system_error>
-#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
 #include "BluetoothGuard.h"
 
 #define HCI_STATE_NONE       0
@@ -14,31 +16,50 @@
 #define HCI_STATE_SCANNING   3
 #define HCI_STATE_FILTERING  4
 
-#define EIR_FLAGS                   0X01
-#define EIR_NAME_SHORT              0x08
-#define EIR_NAME_COMPLETE           0x09
-#define EIR_MANUFACTURE_SPECIFIC    0xFF
+//scanLoop() without arguments
+#define DEFAULT_SCAN_TIME_MS        1000
+//events read at once, the rest is read after next epoll_wait
+#define MAX_EVENTS_PER_WAKEUP       32
+//device snapshot is rebuilt at most this often while scanning
+#define PUBLISH_INTERVAL_MS         100
+
+//monotonic time in ms
+static int64_t monotonic_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+ScanParameters ScanParameters::fastDiscovery() {
+    return ScanParameters{0x01, 0x0010, 0x0010, LE_PUBLIC_ADDRESS, 0x00, true};
+}
 
-BTLEDevice::BTLEDevice(std::string address, std::string name)
-: address(address), name(name) {
+ScanParameters ScanParameters::lowPower() {
+    return ScanParameters{0x00, 0x0800, 0x0012, LE_PUBLIC_ADDRESS, 0x00, true};
 }
 
-BTLEDevice::BTLEDevice(const BTLEDevice& source)
-: address(source.address), name(source.name) {
+ScanParameters ScanParameters::rssiTracking() {
+    return ScanParameters{0x00, 0x0010, 0x0010, LE_PUBLIC_ADDRESS, 0x00, false};
 }
 
-bool BTLEDevice::operator ==(const BTLEDevice& rhs) {
-    return address == rhs.address;
+bool ScanParameters::isValid() const {
+    return type <= 0x01 && interval >= 0x0004 && interval <= 0x4000 && window >= 0x0004 && window <= interval &&
+            filterPolicy <= 0x01;
 }
 
 HciWrapper::HciWrapper(HciWrapperListener& delegate)
-: device_id(0), device_handle(0), state(0), has_error(0), delegate(delegate) {
-  BluetoothGuard::lockBluetooth(this);
+: device_id(0), device_handle(0), state(0), has_error(0), scanGuarded(false), in_scan_loop(false),
+  stop_requested(false), clear_requested(false), last_publish(0),
+  scan_parameters(ScanParameters::fastDiscovery()), delegate(delegate) {
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 }
 
 HciWrapper::~HciWrapper() {
     close_hci_device();
-    BluetoothGuard::unlockBluetooth(this);
+    close(stop_fd);
+    if (scanGuarded == true) {
+        BluetoothGuard::endScan(this);
+    }
 }
 
 void HciWrapper::dumpError() {
@@ -47,24 +68,83 @@ void HciWrapper::dumpError() {
     }
 }
 
-bool HciWrapper::startScan() {
+void HciWrapper::setScanParameters(const ScanParameters& parameters) {
+    scan_parameters = parameters;
+}
+
+ScanParameters HciWrapper::getScanParameters() {
+    return scan_parameters;
+}
+
+bool HciWrapper::addToWhitelist(const std::string& address, uint8_t addressType) {
+    bdaddr_t bdaddr;
+    if (str2ba(address.c_str(), &bdaddr) < 0) {
+        return false;
+    }
+    whitelist.push_back(std::make_pair(bdaddr, addressType));
+    return true;
+}
+
+void HciWrapper::clearWhitelist() {
+    whitelist.clear();
+}
+
+//controller doesn't accept whitelist changes while scanning
+bool HciWrapper::write_whitelist() {
+    if (hci_le_clear_white_list(device_handle, 1000) < 0) {
+        has_error = TRUE;
+        snprintf(error_message, sizeof(error_message), "Failed to clear whitelist: %s", strerror(errno));
+        return false;
+    }
+    for (auto& entry : whitelist) {
+        if (hci_le_add_white_list(device_handle, &entry.first, entry.second, 1000) < 0) {
+            has_error = TRUE;
+            snprintf(error_message, sizeof(error_message), "Failed to add to whitelist: %s", strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HciWrapper::startScan(int timeoutInMs) {
+    has_error = FALSE;
+    //waits until pending connection is created, LE create connection fails while scanning
+    if (scanGuarded == false) {
+        if (BluetoothGuard::beginScan(this, timeoutInMs) == false) {
+            has_error = TRUE;
+            snprintf(error_message, sizeof(error_message), "Adapter busy, scan not started in %d ms", timeoutInMs);
+            printf("ERROR: %s\n", error_message);
+            return false;
+        }
+        scanGuarded = true;
+    }
     open_default_hci_device();
 
     if (has_error) {
-        printf("ERROR: %s\n", error_message);
-        return false;
+        return abort_start_scan();
     }
 
-    if (hci_le_set_scan_parameters(device_handle, 0x01, htobs(0x0010), htobs(0x0010), 0x00, 0x00, 1000) < 0) {
+    if (scan_parameters.isValid() == false) {
+        has_error = TRUE;
+        snprintf(error_message, sizeof(error_message), "Invalid scan parameters");
+        return abort_start_scan();
+    }
+
+    if (scan_parameters.filterPolicy == 0x01 && write_whitelist() == false) {
+        return abort_start_scan();
+    }
+
+    if (hci_le_set_scan_parameters(device_handle, scan_parameters.type, htobs(scan_parameters.interval),
+            htobs(scan_parameters.window), scan_parameters.ownAddressType, scan_parameters.filterPolicy, 1000) < 0) {
         has_error = TRUE;
         snprintf(error_message, sizeof(error_message), "Failed to set scan parameters: %s", strerror(errno));
-        return false;
+        return abort_start_scan();
     }
 
-    if (hci_le_set_scan_enable(device_handle, 0x01, 1, 1000) < 0) {
+    if (hci_le_set_scan_enable(device_handle, 0x01, scan_parameters.filterDuplicates ? 1 : 0, 1000) < 0) {
         has_error = TRUE;
         snprintf(error_message, sizeof(error_message), "Failed to enable scan: %s", strerror(errno));
-        return false;
+        return abort_start_scan();
     }
 
     state = HCI_STATE_SCANNING;
@@ -74,7 +154,7 @@ bool HciWrapper::startScan() {
     if (getsockopt(device_handle, SOL_HCI, HCI_FILTER, &original_filter, &olen) < 0) {
         has_error = TRUE;
         snprintf(error_message, sizeof(error_message), "Could not get socket options: %s", strerror(errno));
-        return false;
+        return abort_start_scan();
     }
 
     // Create and set the new filter
@@ -87,7 +167,7 @@ bool HciWrapper::startScan() {
     if (setsockopt(device_handle, SOL_HCI, HCI_FILTER, &new_filter, sizeof(new_filter)) < 0) {
         has_error = TRUE;
         snprintf(error_message, sizeof(error_message), "Could not set socket options: %s", strerror(errno));
-        return false;
+        return abort_start_scan();
     }
 
     state = HCI_STATE_FILTERING;
@@ -97,108 +177,241 @@ bool HciWrapper::startScan() {
     return true;
 }
 
+//Undoes partially started scan, scan slot is released so connections aren't blocked
+bool HciWrapper::abort_start_scan() {
+    printf("ERROR: %s\n", error_message);
+    if (state == HCI_STATE_SCANNING) {
+        hci_le_set_scan_enable(device_handle, 0x00, 1, 1000);
+    }
+    close_hci_device();
+    if (scanGuarded == true) {
+        BluetoothGuard::endScan(this);
+        scanGuarded = false;
+    }
+    return false;
+}
+
 void HciWrapper::scanLoop() {
-    //printf("Begin of scan loop!\n");
-    bool error = false;
-    int counter = 10000;
-    while (error != true && counter > 0) {
-        counter --;
-        int len = 0;
-        unsigned char buf[HCI_MAX_EVENT_SIZE];
-        while ((len = read(device_handle, buf, sizeof(buf))) < 0) {
-            counter--;
-            if (counter < 0) {
-                //printf("End of scan loop!\n");
-                return;
+    scanLoop(DEFAULT_SCAN_TIME_MS);
+}
+
+bool HciWrapper::scanLoop(int timeoutInMs) {
+    if (state != HCI_STATE_FILTERING) {
+        printf("%s: scan is not started\n", __func__);
+        return false;
+    }
+
+    //stop requested while no loop was running is stale, it mustn't end this loop at once
+    uint64_t stale;
+    if (read(stop_fd, &stale, sizeof(stale)) < 0) {
+        //nothing pending
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        printf("%s: epoll_create failed: %s\n", __func__, strerror(errno));
+        return false;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = device_handle;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device_handle, &event) < 0) {
+        printf("%s: epoll_ctl failed for HCI socket: %s\n", __func__, strerror(errno));
+        close(epoll_fd);
+        return false;
+    }
+    event.data.fd = stop_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event) < 0) {
+        printf("%s: epoll_ctl failed for stop event: %s\n", __func__, strerror(errno));
+        close(epoll_fd);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(scan_mutex);
+        in_scan_loop = true;
+    }
+
+    int64_t end_time = monotonic_ms() + timeoutInMs;
+    bool result = true;
+
+    while (true) {
+        int wait_time = -1;
+        if (timeoutInMs >= 0) {
+            int64_t remaining = end_time - monotonic_ms();
+            if (remaining <= 0) {
+                break;
             }
+            wait_time = (int) remaining;
+        }
+
+        //sleeps until advertising report comes, no CPU is used while idle
+        struct epoll_event ready[2];
+        int count = epoll_wait(epoll_fd, ready, 2, wait_time);
+        if (count < 0) {
             if (errno == EINTR) {
-                return;
-            }
-            if (errno == EAGAIN) {
-                usleep(100);
                 continue;
             }
-           return;
+            printf("%s: epoll_wait failed: %s\n", __func__, strerror(errno));
+            result = false;
+            break;
         }
 
-        evt_le_meta_event *meta = (evt_le_meta_event *) (buf + (1 + HCI_EVENT_HDR_SIZE));
-        len -= (1 + HCI_EVENT_HDR_SIZE);
-
-        if (meta->subevent != EVT_LE_ADVERTISING_REPORT) {
-            continue;
+        bool stop = false;
+        for (int i = 0; i < count; i++) {
+            if (ready[i].data.fd == stop_fd) {
+                uint64_t value;
+                if (read(stop_fd, &value, sizeof(value)) < 0) {
+                    //already cleared
+                }
+                if (handle_scan_requests() == true) {
+                    stop = true;
+                }
+            } else if (read_hci_events() == false) {
+                result = false;
+                stop = true;
+            }
         }
+        if (stop == true) {
+            break;
+        }
+    }
 
-        le_advertising_info *info = (le_advertising_info *) (meta->data + 1);
-
-//        printf("Event: %d\n", info->evt_type);
-//        printf("Length: %d\n", info->length);
+    close(epoll_fd);
+    publish_devices(true);
+    {
+        //registry goes back to callers, clear requested after last wakeup is done here
+        std::lock_guard<std::mutex> guard(scan_mutex);
+        if (clear_requested == true) {
+            registry.clear();
+        }
+        in_scan_loop = false;
+        stop_requested = false;
+        clear_requested = false;
+    }
+    return result;
+}
 
-        if (info->length == 0) {
-            continue;
+void HciWrapper::stopScanLoop() {
+    {
+        std::lock_guard<std::mutex> guard(scan_mutex);
+        if (in_scan_loop == false) {
+            return;
         }
+        stop_requested = true;
+    }
+    wake_scan_loop();
+}
 
-        int current_index = 0;
-        int data_error = 0;
+void HciWrapper::wake_scan_loop() {
+    uint64_t value = 1;
+    if (write(stop_fd, &value, sizeof(value)) < 0) {
+        printf("%s: can't wake scan loop: %s\n", __func__, strerror(errno));
+    }
+}
 
-        while (!data_error && current_index < info->length) {
-            size_t data_len = info->data[current_index];
+//Scan thread, applies pending clear, true when stop was requested
+bool HciWrapper::handle_scan_requests() {
+    bool clear;
+    bool stop;
+    {
+        std::lock_guard<std::mutex> guard(scan_mutex);
+        clear = clear_requested;
+        stop = stop_requested;
+        clear_requested = false;
+        stop_requested = false;
+    }
+    if (clear == true) {
+        registry.clear();
+    }
+    return stop;
+}
 
-            if (data_len + 1 > info->length) {
-                printf("EIR data length is longer than EIR packet length. %d + 1 > %d", data_len, info->length);
-                data_error = 1;
-            } else {
-                scan_process_data(info->data + current_index + 1, data_len, info);
-                //get_rssi(&info->bdaddr, current_hci_state);
-                current_index += data_len + 1;
+//Reads all queued events up to MAX_EVENTS_PER_WAKEUP, false on socket error
+bool HciWrapper::read_hci_events() {
+    unsigned char buf[HCI_MAX_EVENT_SIZE];
+    for (int events = 0; events < MAX_EVENTS_PER_WAKEUP; events++) {
+        int len = read(device_handle, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                //usual end of short burst, its reports are published too
+                break;
             }
+            printf("%s: read failed: %s\n", __func__, strerror(errno));
+            return false;
         }
+        process_hci_event(buf, len);
     }
-//    printf("End of scan loop!\n");
+    publish_devices(false);
+    return true;
 }
 
-void HciWrapper::addToDevicePool(BTLEDevice& device) {
-    if (std::find(foundDevices.begin(), foundDevices.end(), device) != foundDevices.end() ) {
-        return;
+void HciWrapper::publish_devices(bool force) {
+    int64_t now = monotonic_ms();
+    if (force == true || now - last_publish >= PUBLISH_INTERVAL_MS) {
+        registry.publish();
+        last_publish = now;
     }
-    foundDevices.push_back(device);
-    delegate.onNewDeviceFound(device);
 }
 
-void HciWrapper::scan_process_data(uint8_t *data, size_t data_len, le_advertising_info *info) {
-    if (data[0] == EIR_NAME_SHORT || data[0] == EIR_NAME_COMPLETE) {
-        size_t name_len = data_len;
-        char *name = (char*) malloc(name_len + 1);
-        memset(name, 0, name_len + 1);
-        memcpy(name, &data[1], name_len);
-
-        char addr[19];
-        ba2str(&info->bdaddr, addr);
-        addr[18] = 0;
+void HciWrapper::process_hci_event(unsigned char* buf, int len) {
+    if (len < 1 + HCI_EVENT_HDR_SIZE + 2) {
+        return;
+    }
+    evt_le_meta_event *meta = (evt_le_meta_event *) (buf + (1 + HCI_EVENT_HDR_SIZE));
 
-        BTLEDevice device(addr, name);
-        addToDevicePool(device);
+    if (meta->subevent != EVT_LE_ADVERTISING_REPORT) {
+        return;
+    }
 
-        free(name);
-    } /* not needed now
-      else if (data[0] == EIR_FLAGS) {
-        printf("Flag type: len=%d\n", data_len);
-        unsigned int i;
-        for (i = 1; i < data_len; i++) {
-            printf("\tFlag data: 0x%0X\n", data[i]);
+    //one event can carry more reports, each one is followed by RSSI byte
+    uint8_t reports = meta->data[0];
+    uint8_t *report = meta->data + 1;
+    uint8_t *end = buf + len;
+    int64_t now = monotonic_ms();
+
+    for (int r = 0; r < reports; r++) {
+        le_advertising_info *info = (le_advertising_info *) report;
+        if (report + LE_ADVERTISING_INFO_SIZE > end || report + LE_ADVERTISING_INFO_SIZE + info->length + 1 > end) {
+            printf("Advertising report is longer than HCI event.\n");
+            return;
         }
-    } else if (data[0] == EIR_MANUFACTURE_SPECIFIC) {
-        printf("Manufacture specific type: len=%d\n", data_len);
+        report += LE_ADVERTISING_INFO_SIZE + info->length + 1;
+
+//        printf("Event: %d\n", info->evt_type);
+//        printf("Length: %d\n", info->length);
 
-        // TODO int company_id = data[current_index + 2]
+        bool is_new = false;
+        BTLEDevice& device = registry.touch(info->bdaddr, info->bdaddr_type, (int8_t) info->data[info->length], now,
+                is_new);
+        bool had_name = device.name.empty() == false;
 
-        unsigned int i;
-        for (i = 1; i < data_len; i++) {
-            printf("\tData: 0x%0X\n", data[i]);
+        AdvertisingData data;
+        data.eventType = info->evt_type;
+        data.rssi = device.rssi;
+        if (decodeAdvertisingData(info->data, info->length, data) == false) {
+            printf("Malformed advertising data of %s\n", device.address.c_str());
         }
-    } else {
-        printf("Unknown type: type=%X\n", data[0]);
-    } */
+        update_device(device, data);
 
+        //device is reported when its name is known
+        if (had_name == false && device.name.empty() == false) {
+            delegate.onNewDeviceFound(device);
+        }
+        delegate.onAdvertisingData(device, data);
+    }
+}
+
+void HciWrapper::update_device(BTLEDevice& device, const AdvertisingData& data) {
+    if (data.name.empty() == false && data.name != device.name) {
+        device.name.assign(data.name.data(), data.name.size());
+    }
+    if (data.hasManufacturerData == true) {
+        //company id and payload
+        const uint8_t* begin = data.manufacturerData.data - 2;
+        device.manufacturerData.assign(begin, data.manufacturerData.data + data.manufacturerData.length);
+    }
 }
 
 void HciWrapper::stopScan() {
@@ -213,6 +426,10 @@ void HciWrapper::stopScan() {
     }
 
     close_hci_device();
+    if (scanGuarded == true) {
+        BluetoothGuard::endScan(this);
+        scanGuarded = false;
+    }
     delegate.onScanStop();
 }
 
@@ -231,6 +448,7 @@ void HciWrapper::open_default_hci_device() {
         has_error = TRUE;
         snprintf(error_message, sizeof(error_message),
                 "Could set device to non-blocking: %s", strerror(errno));
+        hci_close_dev(device_handle);
         return;
     }
 
@@ -239,18 +457,38 @@ void HciWrapper::open_default_hci_device() {
 
 void HciWrapper::close_hci_device()
 {
-  if(state == HCI_STATE_OPEN) {
+  //device stays open in scanning states too, so scan can be started again
+  if(state != HCI_STATE_NONE) {
     hci_close_dev(device_handle);
   }
   state = HCI_STATE_NONE;
 }
 
 void HciWrapper::clearFoundDevices() {
-    foundDevices.clear();
+    {
+        std::lock_guard<std::mutex> guard(scan_mutex);
+        if (in_scan_loop == false) {
+            registry.clear();
+            return;
+        }
+        //registry is modified by scan thread only
+        clear_requested = true;
+    }
+    wake_scan_loop();
 }
 
 std::vector<BTLEDevice> HciWrapper::getFoundDevices() {
-    return std::vector<BTLEDevice>(foundDevices);
+    std::vector<BTLEDevice> result;
+    for (const BTLEDevice& device : *registry.getSnapshot()) {
+        if (device.name.empty() == false) {
+            result.push_back(device);
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<const BTLEDeviceList> HciWrapper::getDevices() {
+    return registry.getSnapshot();
 }
 
 static int disconnectConnectionsOnDevice(int s, int dev_id, long arg) {
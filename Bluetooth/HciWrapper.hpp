@@ -20,16 +20,9 @@
 #include <bluetooth/hci_lib.h>
 #include <string>
 #include <vector>
-
-class BTLEDevice {
-    public:
-        std::string address;
-        std::string name;
-        bool operator ==(const BTLEDevice& rhs);
-
-        BTLEDevice(std::string address, std::string name);
-        BTLEDevice(const BTLEDevice& source);
-};
+#include <mutex>
+#include "BtleDeviceRegistry.h"
+#include "AdvertisingData.h"
 
 class HciWrapperListener {
     public:
@@ -37,6 +30,27 @@ class HciWrapperListener {
         virtual void onScanStart() = 0;
         virtual void onScanStop() = 0;
         virtual void onNewDeviceFound(const BTLEDevice& device) = 0;
+        //each advertising report, data points into scan buffer and is valid only during call
+        virtual void onAdvertisingData(const BTLEDevice& device, const AdvertisingData& data) {}
+};
+
+//LE scan configuration, times are in 0.625 ms units (0x0004 - 0x4000)
+struct ScanParameters {
+    uint8_t type;           //0x00 passive, 0x01 active (scan responses are requested)
+    uint16_t interval;
+    uint16_t window;        //radio is on for window of each interval, window <= interval
+    uint8_t ownAddressType;
+    uint8_t filterPolicy;   //0x00 all advertisers, 0x01 whitelist only
+    bool filterDuplicates;  //controller reports each device once per scan
+
+    //active scan with 100% duty cycle, names come in scan responses
+    static ScanParameters fastDiscovery();
+    //passive scan with ~1% duty cycle
+    static ScanParameters lowPower();
+    //passive scan, every report is delivered
+    static ScanParameters rssiTracking();
+
+    bool isValid() const;
 };
 
 class HciWrapper {
@@ -44,12 +58,31 @@ class HciWrapper {
         HciWrapper(HciWrapperListener& delegate);
         ~HciWrapper();
 
-        bool startScan();
+        //used by next startScan(), default is fast discovery
+        void setScanParameters(const ScanParameters& parameters);
+        ScanParameters getScanParameters();
+        //used only when filterPolicy is 0x01, it's written to controller by startScan()
+        bool addToWhitelist(const std::string& address, uint8_t addressType = LE_PUBLIC_ADDRESS);
+        void clearWhitelist();
+
+        //Waits up to timeoutInMs until pending connection is created. On failure adapter is left
+        //as it was, reason is printed by dumpError().
+        bool startScan(int timeoutInMs = 10000);
+        //scans for DEFAULT_SCAN_TIME_MS
         void scanLoop();
+        //Blocks in epoll until reports come, negative timeout scans until stopScanLoop().
+        //False on socket error.
+        bool scanLoop(int timeoutInMs);
+        //can be called from any thread, wakes blocked scanLoop(). Stop requested between loops is ignored.
+        void stopScanLoop();
         void stopScan();
         void dumpError();
+        //any thread, while scanLoop() runs the registry is cleared on scan thread at its next wakeup
         void clearFoundDevices();
+        //devices with name, as before
         std::vector<BTLEDevice> getFoundDevices();
+        //all seen devices, snapshot is shared and lock free, it's refreshed while scanning
+        std::shared_ptr<const BTLEDeviceList> getDevices();
         static void destroyAllConnections();
         static void restartBTLE();
     private:
@@ -59,13 +92,29 @@ class HciWrapper {
         int state;
         int has_error;
         char error_message[1024];
-        std::vector<BTLEDevice>  foundDevices;
+        bool scanGuarded;   //scan slot of BluetoothGuard is held
+        int stop_fd;        //eventfd waking scanLoop, for stop or clear request
+        std::mutex scan_mutex;
+        bool in_scan_loop;      //registry is owned by scan thread, guarded by scan_mutex
+        bool stop_requested;    //guarded by scan_mutex
+        bool clear_requested;   //guarded by scan_mutex
+        BtleDeviceRegistry registry;
+        int64_t last_publish;
+        ScanParameters scan_parameters;
+        std::vector<std::pair<bdaddr_t, uint8_t> > whitelist;
         HciWrapperListener& delegate;
 
+        friend class HciWrapperTests;
+        bool write_whitelist();
+        bool abort_start_scan();
         void open_default_hci_device();
         void close_hci_device();
-        void scan_process_data(uint8_t *data, size_t data_len, le_advertising_info *info);
-        void addToDevicePool(BTLEDevice& device);
+        bool read_hci_events();
+        bool handle_scan_requests();
+        void wake_scan_loop();
+        void process_hci_event(unsigned char* buf, int len);
+        void update_device(BTLEDevice& device, const AdvertisingData& data);
+        void publish_devices(bool force);
 };
 
 #endif /* HciWrapper_hpp */
@@ -0,0 +1,69 @@
+/*
+ * HciWrapperTests.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "HciWrapperTests.hpp"
+#include "HciWrapper.hpp"
+#include <sys/socket.h>
+#include <vector>
+
+class NullListener : public HciWrapperListener {
+  public:
+    void onScanStart() override {}
+    void onScanStop() override {}
+    void onNewDeviceFound(const BTLEDevice& device) override {}
+};
+
+//LE meta event with single advertising report of device whose address ends with lastByte
+static std::vector<uint8_t> advertisingEvent(uint8_t lastByte) {
+  const uint8_t name[] = {3, 0x09, 'T', lastByte};
+  std::vector<uint8_t> report = {0x00, LE_PUBLIC_ADDRESS, lastByte, 0x22, 0x33, 0x44, 0x55, 0x66, sizeof(name)};
+  report.insert(report.end(), name, name + sizeof(name));
+  report.push_back((uint8_t) -60);
+
+  std::vector<uint8_t> event = {HCI_EVENT_PKT, EVT_LE_META_EVENT, (uint8_t) (report.size() + 2),
+      EVT_LE_ADVERTISING_REPORT, 1};
+  event.insert(event.end(), report.begin(), report.end());
+  return event;
+}
+
+//Scan internals are reached through socket pair instead of adapter
+class HciWrapperTests {
+  public:
+    static bool testShortBurstIsPublished() {
+      bool testResult = true;
+      NullListener listener;
+      HciWrapper hci(listener);
+      int sockets[2];
+      if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, sockets) != 0) {
+        return false;
+      }
+      hci.device_handle = sockets[0];
+
+      //fewer events than MAX_EVENTS_PER_WAKEUP, read ends with EAGAIN
+      for (uint8_t device = 1; device <= 3; device++) {
+        std::vector<uint8_t> event = advertisingEvent(device);
+        testResult &= write(sockets[1], event.data(), event.size()) == (ssize_t) event.size();
+      }
+      hci.last_publish = 0;
+      testResult &= hci.read_hci_events() == true;
+      std::shared_ptr<const BTLEDeviceList> devices = hci.getDevices();
+      testResult &= devices != nullptr && devices->size() == 3;
+      testResult &= hci.getFoundDevices().size() == 3;
+
+      hci.device_handle = 0;
+      close(sockets[0]);
+      close(sockets[1]);
+      return testResult;
+    }
+};
+
+bool testHciWrapper() {
+  bool result = true;
+
+  result &= HciWrapperTests::testShortBurstIsPublished();
+  return result;
+}
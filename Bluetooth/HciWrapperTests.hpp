@@ -0,0 +1,13 @@
+/*
+ * HciWrapperTests.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef HciWrapperTests_hpp
+#define HciWrapperTests_hpp
+
+bool testHciWrapper();
+
+#endif /* HciWrapperTests_hpp */
@@ -0,0 +1,183 @@
+/*
+ * LineRingBuffer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "LineRingBuffer.h"
+#include <string.h>
+#include <algorithm>
+#include "../Parsers/CharScanner.h"
+
+static size_t roundUpToPowerOf2(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+LineRingBuffer::LineRingBuffer(size_t capacity, RingOverflowPolicy policy)
+: capacity(roundUpToPowerOf2(capacity)),
+  mask(this->capacity - 1),
+  policy(policy),
+  ring(new char[this->capacity]),
+  scratch(new char[this->capacity]),
+  committed(0),
+  released(0),
+  discarded(0),
+  writePosition(0),
+  swallowToEndOfLine(false),
+  borrowedLength(0),
+  bytesReceived(0),
+  bytesDropped(0),
+  linesReceived(0),
+  linesRead(0),
+  overflows(0),
+  highWatermark(0) {
+
+}
+
+void LineRingBuffer::copyIn(size_t position, const char* data, size_t length) {
+  const size_t index = position & mask;
+  const size_t firstPart = std::min(length, capacity - index);
+  memcpy(ring.get() + index, data, firstPart);
+  memcpy(ring.get(), data + firstPart, length - firstPart);
+}
+
+bool LineRingBuffer::append(const uint8_t* bytes, size_t length) {
+  const char* data = reinterpret_cast<const char*>(bytes);
+  bytesReceived.fetch_add(length, std::memory_order_relaxed);
+  bool result = true;
+
+  while (length > 0) {
+    if (swallowToEndOfLine == true) {
+      //rest of line which didn't fit
+      const size_t end = scanEndOfLine(data, length);
+      const size_t dropped = end == length ? length : end + 1;
+      bytesDropped.fetch_add(dropped, std::memory_order_relaxed);
+      swallowToEndOfLine = end == length;
+      data += dropped;
+      length -= dropped;
+      continue;
+    }
+
+    const size_t used = writePosition - released.load(std::memory_order_acquire);
+    const size_t toCopy = std::min(length, capacity - used);
+    copyIn(writePosition, data, toCopy);
+
+    //only new bytes are scanned, CR positions are tracked incrementally
+    size_t lineEnd = 0;
+    size_t lines = 0;
+    while (lineEnd < toCopy) {
+      const size_t end = scanEndOfLine(data + lineEnd, toCopy - lineEnd);
+      if (lineEnd + end == toCopy) {
+        break;
+      }
+      lineEnd += end + 1;
+      lines++;
+    }
+    if (lines > 0) {
+      linesReceived.fetch_add(lines, std::memory_order_relaxed);
+      committed.store(writePosition + lineEnd, std::memory_order_release);
+    }
+    writePosition += toCopy;
+    if (used + toCopy > highWatermark.load(std::memory_order_relaxed)) {
+      highWatermark.store(used + toCopy, std::memory_order_relaxed);
+    }
+    data += toCopy;
+    length -= toCopy;
+    if (length == 0) {
+      break;
+    }
+
+    //overflow
+    result = false;
+    overflows.fetch_add(1, std::memory_order_relaxed);
+    if (policy == ropDropBytes) {
+      bytesDropped.fetch_add(length, std::memory_order_relaxed);
+      break;
+    }
+    //not committed bytes belong to producer, so partial line can be taken back
+    const size_t partial = writePosition - committed.load(std::memory_order_relaxed);
+    bytesDropped.fetch_add(partial, std::memory_order_relaxed);
+    writePosition -= partial;
+    swallowToEndOfLine = true;
+  }
+  return result;
+}
+
+void LineRingBuffer::dropPartialLine() {
+  const size_t partial = writePosition - committed.load(std::memory_order_relaxed);
+  bytesDropped.fetch_add(partial, std::memory_order_relaxed);
+  writePosition -= partial;
+}
+
+//Consumer indices are not touched here, complete lines are counted as dropped when consumer skips them
+void LineRingBuffer::clear() {
+  dropPartialLine();
+  swallowToEndOfLine = false;
+  discarded.store(committed.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+bool LineRingBuffer::borrowLine(std::string_view& outLine) {
+  size_t start = released.load(std::memory_order_relaxed);
+  const size_t skipTo = discarded.load(std::memory_order_acquire);
+  if (skipTo > start && borrowedLength == 0) {
+    //lines dropped by clear(), space is returned to producer
+    bytesDropped.fetch_add(skipTo - start, std::memory_order_relaxed);
+    released.store(skipTo, std::memory_order_release);
+    start = skipTo;
+  }
+  const size_t end = committed.load(std::memory_order_acquire);
+  if (start == end) {
+    return false;
+  }
+
+  const size_t index = start & mask;
+  const size_t firstPart = std::min(end - start, capacity - index);
+  const size_t length = scanEndOfLine(ring.get() + index, firstPart);
+  if (length < firstPart) {
+    outLine = std::string_view(ring.get() + index, length);
+    borrowedLength = length + 1;
+    return true;
+  }
+
+  //wrapped line, CR is always before committed position
+  const size_t secondPart = scanEndOfLine(ring.get(), end - start - firstPart);
+  memcpy(scratch.get(), ring.get() + index, firstPart);
+  memcpy(scratch.get() + firstPart, ring.get(), secondPart);
+  outLine = std::string_view(scratch.get(), firstPart + secondPart);
+  borrowedLength = firstPart + secondPart + 1;
+  return true;
+}
+
+void LineRingBuffer::releaseLine() {
+  if (borrowedLength == 0) {
+    return;
+  }
+  released.store(released.load(std::memory_order_relaxed) + borrowedLength, std::memory_order_release);
+  borrowedLength = 0;
+  linesRead.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool LineRingBuffer::hasLine() const {
+  const size_t start = std::max(released.load(std::memory_order_relaxed), discarded.load(std::memory_order_acquire));
+  return start != committed.load(std::memory_order_acquire);
+}
+
+size_t LineRingBuffer::getCapacity() const {
+  return capacity;
+}
+
+LineRingBufferStats LineRingBuffer::getStats() const {
+  LineRingBufferStats result;
+  result.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+  result.bytesDropped = bytesDropped.load(std::memory_order_relaxed);
+  result.linesReceived = linesReceived.load(std::memory_order_relaxed);
+  result.linesRead = linesRead.load(std::memory_order_relaxed);
+  result.overflows = overflows.load(std::memory_order_relaxed);
+  result.highWatermark = highWatermark.load(std::memory_order_relaxed);
+  return result;
+}
@@ -0,0 +1,82 @@
+/*
+ * LineRingBuffer.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef LineRingBuffer_hpp
+#define LineRingBuffer_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <string_view>
+
+enum RingOverflowPolicy {
+  ropDropLine,    //partial line and rest of incoming data up to next CR are dropped, lines are never corrupted
+  ropDropBytes    //only bytes which don't fit are dropped, current line will be corrupted
+};
+
+struct LineRingBufferStats {
+  uint64_t bytesReceived;
+  uint64_t bytesDropped;
+  uint64_t linesReceived;
+  uint64_t linesRead;
+  uint64_t overflows;
+  size_t   highWatermark;   //max bytes kept in buffer
+};
+
+//Fixed capacity single producer/single consumer queue of CR terminated lines. Producer (GLib event loop)
+//appends bytes without locks, consumer borrows complete lines which stay valid until releaseLine().
+class LineRingBuffer {
+  public:
+    //capacity is rounded up to power of 2
+    LineRingBuffer(size_t capacity, RingOverflowPolicy policy = ropDropLine);
+
+    //producer side, false if some bytes were dropped due to overflow
+    bool append(const uint8_t* data, size_t length);
+    //producer side, drops not completed line
+    void dropPartialLine();
+    //producer side, drops everything received so far, including rest of overflowed line. Consumer skips
+    //dropped lines at its next borrowLine(), line borrowed meanwhile stays valid until releaseLine().
+    void clear();
+
+    //consumer side, line is without CR. Lines wrapped around end of buffer are linearized
+    //in consumer scratch buffer, others point directly into ring.
+    bool borrowLine(std::string_view& outLine);
+    void releaseLine();
+    bool hasLine() const;
+
+    size_t getCapacity() const;
+    LineRingBufferStats getStats() const;
+  private:
+    const size_t capacity;
+    const size_t mask;
+    const RingOverflowPolicy policy;
+    std::unique_ptr<char[]> ring;
+    std::unique_ptr<char[]> scratch;
+
+    //positions are not wrapped, index in ring is position & mask
+    std::atomic<size_t> committed;  //end of last complete line, written by producer
+    std::atomic<size_t> released;   //start of first unread line, written by consumer
+    std::atomic<size_t> discarded;  //lines before it were dropped by clear(), written by producer
+
+    //producer only
+    size_t writePosition;
+    bool swallowToEndOfLine;
+    //consumer only
+    size_t borrowedLength;
+
+    std::atomic<uint64_t> bytesReceived;
+    std::atomic<uint64_t> bytesDropped;
+    std::atomic<uint64_t> linesReceived;
+    std::atomic<uint64_t> linesRead;
+    std::atomic<uint64_t> overflows;
+    std::atomic<size_t> highWatermark;
+
+    void copyIn(size_t position, const char* data, size_t length);
+};
+
+#endif /* LineRingBuffer_hpp */
@@ -0,0 +1,123 @@
+/*
+ * LineRingBufferTests.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "LineRingBufferTests.hpp"
+#include "LineRingBuffer.h"
+#include <string.h>
+
+static bool append(LineRingBuffer& ring, const char* data) {
+  return ring.append(reinterpret_cast<const uint8_t*>(data), strlen(data));
+}
+
+static bool expectLine(LineRingBuffer& ring, const char* expected) {
+  std::string_view line;
+  if (ring.borrowLine(line) == false) {
+    return false;
+  }
+  const bool result = line == expected;
+  ring.releaseLine();
+  return result;
+}
+
+static bool testLines() {
+  bool testResult = true;
+  LineRingBuffer ring(16);
+  std::string_view line;
+
+  testResult &= append(ring, "abc\rde") == true;
+  testResult &= expectLine(ring, "abc");
+  testResult &= ring.borrowLine(line) == false;
+
+  //line wrapped around end of ring
+  testResult &= append(ring, "fghijklmn\r") == true;
+  testResult &= expectLine(ring, "defghijklmn");
+  testResult &= ring.hasLine() == false;
+  return testResult;
+}
+
+static bool testOverflowInsideLine() {
+  bool testResult = true;
+  LineRingBuffer ring(16);
+
+  //whole line which doesn't fit is dropped, next one is kept
+  testResult &= append(ring, "0123456789abcdefXYZ\rok\r") == false;
+  testResult &= expectLine(ring, "ok");
+  testResult &= ring.hasLine() == false;
+  testResult &= ring.getStats().overflows == 1;
+  return testResult;
+}
+
+static bool testOverflowAtLineBoundary() {
+  bool testResult = true;
+  LineRingBuffer ring(8);
+
+  //ring is full exactly at CR, so nothing of overflowing line is stored
+  testResult &= append(ring, "abc\rdef\r") == true;
+  testResult &= append(ring, "lost") == false;
+  testResult &= expectLine(ring, "abc");
+  testResult &= expectLine(ring, "def");
+  //CR ends dropped line, following complete line is kept
+  testResult &= append(ring, "\rkept\r") == true;
+  testResult &= expectLine(ring, "kept");
+  testResult &= ring.hasLine() == false;
+
+  //the same when terminator comes in the same chunk as overflowing line
+  testResult &= append(ring, "gh\r") == true;
+  testResult &= append(ring, "ij\rxyzxyz\rkl\r") == false;
+  testResult &= expectLine(ring, "gh");
+  testResult &= expectLine(ring, "ij");
+  testResult &= append(ring, "mn\r") == true;
+  testResult &= expectLine(ring, "mn");
+  testResult &= ring.hasLine() == false;
+  testResult &= ring.getStats().bytesDropped == strlen("lost\rxyzxyz\rkl\r");
+  return testResult;
+}
+
+static bool testClear() {
+  bool testResult = true;
+  LineRingBuffer ring(8);
+
+  //complete line, partial one and overflow state are all gone
+  testResult &= append(ring, "old\rpart") == true;
+  testResult &= append(ring, "overflow") == false;
+  ring.clear();
+  testResult &= ring.hasLine() == false;
+  testResult &= append(ring, "new\r") == true;
+  testResult &= expectLine(ring, "new");
+  testResult &= ring.getStats().bytesDropped == strlen("old\rpartoverflow");
+  return testResult;
+}
+
+static bool testClearWhileBorrowed() {
+  bool testResult = true;
+  LineRingBuffer ring(8);
+  std::string_view line;
+
+  //producer clears, consumer's borrowed line isn't overwritten until it's released
+  testResult &= append(ring, "ab\rcd\r") == true;
+  testResult &= ring.borrowLine(line) == true;
+  ring.clear();
+  testResult &= ring.hasLine() == false;
+  testResult &= append(ring, "xyz") == false;
+  testResult &= line == "ab";
+  ring.releaseLine();
+  testResult &= append(ring, "\rok\r") == true;
+  testResult &= expectLine(ring, "ok");
+  testResult &= ring.hasLine() == false;
+  return testResult;
+}
+
+bool testLineRingBuffer() {
+  bool result = true;
+
+  result &= testLines();
+  result &= testOverflowInsideLine();
+  result &= testOverflowAtLineBoundary();
+  result &= testClear();
+  result &= testClearWhileBorrowed();
+  return result;
+}
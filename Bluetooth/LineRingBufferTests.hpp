@@ -0,0 +1,13 @@
+/*
+ * LineRingBufferTests.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef LineRingBufferTests_hpp
+#define LineRingBufferTests_hpp
+
+bool testLineRingBuffer();
+
+#endif /* LineRingBufferTests_hpp */
@@ -9,18 +9,20 @@
 
 ReadSyncBlock::ReadSyncBlock(GMutex* mutex)
 : result(nullptr), resultSize(0), mutex(mutex), ready(false) {
-
+    g_cond_init(&readyCondition);
 }
 
 ReadSyncBlock::~ReadSyncBlock() {
     delete[] result;
     result = nullptr;
     mutex = nullptr;
+    g_cond_clear(&readyCondition);
 }
 
 void ReadSyncBlock::setReady() {
     g_mutex_lock(mutex);
     ready = true;
+    g_cond_broadcast(&readyCondition);
     g_mutex_unlock(mutex);
 }
 
@@ -30,3 +32,15 @@ bool ReadSyncBlock::isReady() {
     g_mutex_unlock(mutex);
     return tmp;
 }
+
+bool ReadSyncBlock::waitReady(gint64 endTime) {
+    g_mutex_lock(mutex);
+    while (ready == false) {
+        if (g_cond_wait_until(&readyCondition, mutex, endTime) == false) {
+            break;
+        }
+    }
+    bool tmp = ready;
+    g_mutex_unlock(mutex);
+    return tmp;
+}
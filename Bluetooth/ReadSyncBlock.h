@@ -23,8 +23,11 @@ class ReadSyncBlock {
 
           void setReady();
           bool isReady();
+          //Blocks until setReady() or endTime (monotonic, in us), returns isReady()
+          bool waitReady(gint64 endTime);
       private:
           GMutex* mutex;
+          GCond   readyCondition;
           bool    ready;  //write to it should be synchronized over mutex
 };
 
@@ -0,0 +1,38 @@
+//
+//  TestsMain.cpp
+//  Bluetooth
+//
+//  Created on: Oct 17, 2026
+//      Author: Zarnowski
+//
+
+#include <stdio.h>
+#include "LineRingBufferTests.hpp"
+#include "AdvertisingDataTests.hpp"
+#include "AdvertisementSensorReaderTests.hpp"
+#include "HciWrapperTests.hpp"
+
+//Tests of parts which don't need adapter nor BlueZ daemon
+int main(int argc, const char * argv[]) {
+  if (testLineRingBuffer() == true) {
+    printf("LineRingBuffer: SUCCESS\n");
+  } else {
+    printf("LineRingBuffer: FAILURE\n");
+  }
+  if (testAdvertisingData() == true) {
+    printf("AdvertisingData: SUCCESS\n");
+  } else {
+    printf("AdvertisingData: FAILURE\n");
+  }
+  if (testAdvertisementSensorReader() == true) {
+    printf("AdvertisementSensorReader: SUCCESS\n");
+  } else {
+    printf("AdvertisementSensorReader: FAILURE\n");
+  }
+  if (testHciWrapper() == true) {
+    printf("HciWrapper: SUCCESS\n");
+  } else {
+    printf("HciWrapper: FAILURE\n");
+  }
+  return 0;
+}
@@ -16,6 +16,8 @@ extern "C" {
 }
 #include "BtleCommWrapperold.h"
 #include "BtleCommWrapper.h"
+#include "BtleConnectionManager.h"
+#include "AdvertisementSensorReader.h"
 
 #define HCI_STATE_NONE       0
 #define HCI_STATE_OPEN       2
@@ -150,9 +152,158 @@ void btleCommunicationTest3() {
   delete comm;
 }
 
+//Histogram of send/readLine round trips, peer has to answer each request with a line.
+//Manual tool for real device, there are no reference numbers, compare builds on the same link.
+void btleLatencyTest(const string& address, int requests) {
+  static const gint64 bucketsMs[] = {2, 5, 10, 20, 40, 80, 160, 320};
+  static const int bucketsCount = sizeof(bucketsMs) / sizeof(bucketsMs[0]);
+  int histogram[bucketsCount + 1] = {0};
+  int failures = 0;
+
+  BtleCommWrapper* comm = new BtleCommWrapper();
+  if (comm->connectTo(address, 4000) == true) {
+    for (int t = 0; t < requests; t++) {
+      gint64 startTime = g_get_monotonic_time();
+      if (comm->send("!!!!#RTH1\r") == false || comm->readLine(3000).empty() == true) {
+        failures++;
+        continue;
+      }
+      gint64 elapsedMs = (g_get_monotonic_time() - startTime) / 1000;
+      int bucket = 0;
+      while (bucket < bucketsCount && elapsedMs >= bucketsMs[bucket]) {
+        bucket++;
+      }
+      histogram[bucket]++;
+    }
+    comm->disconnect();
+  }
+  delete comm;
+
+  printf("Round trip latency, %d requests, %d failures\n", requests, failures);
+  for (int t = 0; t <= bucketsCount; t++) {
+    if (t < bucketsCount) {
+      printf("  < %3d ms: %d\n", (int) bucketsMs[t], histogram[t]);
+    } else {
+      printf(" >= %3d ms: %d\n", (int) bucketsMs[bucketsCount - 1], histogram[t]);
+    }
+  }
+}
+
+//Configuration push, all commands are queued at once and responses are matched in order
+void btlePipelineTest(const string& address) {
+  BtleCommWrapper* comm = new BtleCommWrapper();
+  if (comm->connectTo(address, 4000) == true) {
+    vector<std::future<RequestResult>> responses;
+    for (int t = 0; t < 8; t++) {
+      responses.push_back(comm->sendRequestAsync("!!!!#RTH" + std::to_string(t) + "\r", 3000));
+    }
+    for (size_t t = 0; t < responses.size(); t++) {
+      RequestResult result = responses[t].get();
+      printf("%zu: status:%d, resp: %s\n", t, result.status, result.response.c_str());
+    }
+    comm->disconnect();
+  }
+  delete comm;
+}
+
+//Poll cycle over many sensors, devices are served concurrently up to link limit
+void btleManagerTest(const vector<string>& addresses) {
+  BtleConnectionManager manager(4);
+  gint64 startTime = g_get_monotonic_time();
+  std::map<string, RequestResult> results = manager.requestAll(addresses, "!!!!#RTH1\r", 4000);
+  gint64 elapsedMs = (g_get_monotonic_time() - startTime) / 1000;
+  for (auto& result : results) {
+    printf("%s: status:%d, resp: %s\n", result.first.c_str(), result.second.status, result.second.response.c_str());
+  }
+  printf("%zu devices polled in %d ms\n", results.size(), (int) elapsedMs);
+}
+
+//Same poll as btleCommunicationTest3, but link stays up between requests
+void btlePersistentTest(const string& address) {
+  BtleConnectionManager manager(1);
+  manager.setPersistentLinks(PersistentLinkOptions{60000, 20000, "!!!!#RTH1\r", 4000});
+  while (true) {
+    RequestResult result = manager.request(address, "!!!!#RTH1\r");
+    printf("status:%d, resp: %s\n", result.status, result.response.c_str());
+    fflush(stdout);
+    usleep(5000000);
+  }
+}
+
+class SensorPrinter : public SensorReadingListener {
+    public:
+        virtual void onSensorReading(const BTLEDevice& device, const SensorReading& reading) override {
+            printf("%s seq:%d rssi:%d", device.address.c_str(), reading.sequence, reading.rssi);
+            for (int t = 0; t < reading.valueCount; t++) {
+                printf(" %d=%.2f", reading.values[t].type, reading.values[t].value);
+            }
+            printf("\n");
+        }
+};
+
+//Readings broadcast by sensors, no connection is made
+void passiveSensorTest(int timeoutInMs) {
+    SensorPrinter printer;
+    AdvertisementSensorReader reader(printer);
+    HciWrapper hciWrapper(reader);
+    if (hciWrapper.startScan() == false) {
+        hciWrapper.dumpError();
+        return;
+    }
+    hciWrapper.scanLoop(timeoutInMs);
+    hciWrapper.stopScan();
+    SensorReaderStats stats = reader.getStats();
+    printf("reports:%llu readings:%llu duplicates:%llu malformed:%llu\n", (unsigned long long) stats.reports,
+            (unsigned long long) stats.readings, (unsigned long long) stats.duplicates,
+            (unsigned long long) stats.malformed);
+}
+
+class ReportCounter : public HciWrapperListener {
+    public:
+        uint64_t reports = 0;
+        virtual void onScanStart() override {}
+        virtual void onScanStop() override {}
+        virtual void onNewDeviceFound(const BTLEDevice& device) override {}
+        virtual void onAdvertisingData(const BTLEDevice& device, const AdvertisingData& data) override {
+            reports++;
+        }
+};
+
+//Reports per second and distinct devices of each scan profile
+void scanProfileBenchmark(int timeoutInMs) {
+    struct {
+        const char* name;
+        ScanParameters parameters;
+    } profiles[] = {
+        {"fast discovery", ScanParameters::fastDiscovery()},
+        {"low power", ScanParameters::lowPower()},
+        {"rssi tracking", ScanParameters::rssiTracking()},
+    };
+
+    for (auto& profile : profiles) {
+        ReportCounter counter;
+        HciWrapper hciWrapper(counter);
+        hciWrapper.setScanParameters(profile.parameters);
+        if (hciWrapper.startScan() == false) {
+            hciWrapper.dumpError();
+            continue;
+        }
+        hciWrapper.scanLoop(timeoutInMs);
+        hciWrapper.stopScan();
+        printf("%-16s reports/s: %8.1f, devices: %zu\n", profile.name, counter.reports * 1000.0 / timeoutInMs,
+                hciWrapper.getDevices()->size());
+    }
+}
+
 int main(void) {
     hciWrapperTests();
 //    btleCommunicationTest2();
     btleCommunicationTest3();
+//    btleLatencyTest("5C:F8:21:F9:80:BD", 200);
+//    btlePipelineTest("5C:F8:21:F9:80:BD");
+//    btleManagerTest({"5C:F8:21:F9:80:BD", "5C:F8:21:F9:93:74"});
+//    btlePersistentTest("5C:F8:21:F9:80:BD");
+//    passiveSensorTest(60000);
+//    scanProfileBenchmark(10000);
     return 0;
 }
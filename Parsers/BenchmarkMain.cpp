@@ -0,0 +1,23 @@
+//
+//  BenchmarkMain.cpp
+//  Parsers
+//
+//  Created on: Oct 17, 2026
+//      Author: Zarnowski
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "CharScannerBenchmark.hpp"
+#include "ParsersBenchmark.hpp"
+
+//usage: benchmark [--json]
+int main(int argc, const char * argv[]) {
+    const bool json = argc > 1 && strcmp(argv[1], "--json") == 0;
+    if (json == false) {
+        benchmarkCharScanner();
+        printf("\n");
+    }
+    benchmarkParsers(json);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * CharScanner.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef CharScanner_hpp
+#define CharScanner_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+//Scanning kernels shared by parsers and BTLE line reader. Each function returns index of first
+//matching byte or length if there is none. Vector versions are used if compiler targets SSE2/AVX2,
+//on other platforms (ARM, AVR) scalar loops are used. Default x86-64 build targets SSE2 only,
+//AVX2 kernels need -mavx2 (about 3x faster on long runs).
+
+//first '"' or byte outside of #32-#126
+inline size_t scanStringRunScalar(const char* data, size_t length) {
+    size_t t = 0;
+    for (; t < length; t++) {
+        const char c = data[t];
+        if (c < ' ' || c > '~' || c == '"') {
+            break;
+        }
+    }
+    return t;
+}
+
+//first '"', ',', '(', ')' or CR
+inline size_t scanDelimiterScalar(const char* data, size_t length) {
+    size_t t = 0;
+    for (; t < length; t++) {
+        const char c = data[t];
+        if (c == '"' || c == ',' || c == '(' || c == ')' || c == 13) {
+            break;
+        }
+    }
+    return t;
+}
+
+//first CR
+inline size_t scanEndOfLineScalar(const char* data, size_t length) {
+    size_t t = 0;
+    for (; t < length && data[t] != 13; t++) {
+    }
+    return t;
+}
+
+#if defined(__SSE2__)
+
+//bit set for each byte which ends string run, signed compare so bytes >= 128 are also below ' '
+inline uint32_t stringRunMask16(const char* data) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(' ')),
+        _mm_cmpgt_epi8(v, _mm_set1_epi8('~'))), _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hit));
+}
+
+inline uint32_t delimiterMask16(const char* data) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('(')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(')'))));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(13)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hit));
+}
+
+inline uint32_t endOfLineMask16(const char* data) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(13))));
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline uint32_t stringRunMask32(const char* data) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(' '), v),
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8('~'))), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+inline uint32_t delimiterMask32(const char* data) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+    hit = _mm256_or_si256(hit, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')'))));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(13)));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+inline uint32_t endOfLineMask32(const char* data) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(13))));
+}
+
+#endif
+
+//32 bytes blocks with AVX2, then 16 bytes blocks with SSE2, rest is done by scalar loop
+#if defined(__AVX2__)
+    #define CHAR_SCANNER_BLOCKS(mask32, mask16) \
+        for (; t + 32 <= length; t += 32) { \
+            const uint32_t mask = mask32(data + t); \
+            if (mask != 0) { \
+                return t + __builtin_ctz(mask); \
+            } \
+        } \
+        for (; t + 16 <= length; t += 16) { \
+            const uint32_t mask = mask16(data + t); \
+            if (mask != 0) { \
+                return t + __builtin_ctz(mask); \
+            } \
+        }
+#elif defined(__SSE2__)
+    #define CHAR_SCANNER_BLOCKS(mask32, mask16) \
+        for (; t + 16 <= length; t += 16) { \
+            const uint32_t mask = mask16(data + t); \
+            if (mask != 0) { \
+                return t + __builtin_ctz(mask); \
+            } \
+        }
+#else
+    #define CHAR_SCANNER_BLOCKS(mask32, mask16)
+#endif
+
+inline size_t scanStringRun(const char* data, size_t length) {
+    size_t t = 0;
+    CHAR_SCANNER_BLOCKS(stringRunMask32, stringRunMask16)
+    return t + scanStringRunScalar(data + t, length - t);
+}
+
+inline size_t scanDelimiter(const char* data, size_t length) {
+    size_t t = 0;
+    CHAR_SCANNER_BLOCKS(delimiterMask32, delimiterMask16)
+    return t + scanDelimiterScalar(data + t, length - t);
+}
+
+inline size_t scanEndOfLine(const char* data, size_t length) {
+    size_t t = 0;
+    CHAR_SCANNER_BLOCKS(endOfLineMask32, endOfLineMask16)
+    return t + scanEndOfLineScalar(data + t, length - t);
+}
+
+#undef CHAR_SCANNER_BLOCKS
+
+#endif /* CharScanner_hpp */
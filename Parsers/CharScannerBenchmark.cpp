@@ -0,0 +1,70 @@
+/*
+ * CharScannerBenchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "CharScannerBenchmark.hpp"
+#include "CharScanner.h"
+#include "InParser.h"
+#include <stdio.h>
+#include <chrono>
+
+using namespace std::chrono;
+
+typedef size_t (*ScanFunction)(const char*, size_t);
+
+static volatile size_t sink;
+
+static double measureMBps(ScanFunction function, const string& data, size_t iterations) {
+    steady_clock::time_point start = steady_clock::now();
+    size_t total = 0;
+    for (size_t t = 0; t < iterations; t++) {
+        total += function(data.data(), data.size());
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    sink = total;
+    return (data.size() * iterations) / seconds / 1e6;
+}
+
+static double measureParseMBps(const string& data, size_t iterations) {
+    InParser parser;
+    RemoteCommandView view;
+    steady_clock::time_point start = steady_clock::now();
+    size_t total = 0;
+    for (size_t t = 0; t < iterations; t++) {
+        total += parser.parse(string_view(data), view).error;
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    sink = total;
+    return (data.size() * iterations) / seconds / 1e6;
+}
+
+void benchmarkCharScanner() {
+#if defined(__AVX2__)
+    const char* kernel = "AVX2";
+#elif defined(__SSE2__)
+    const char* kernel = "SSE2";
+#else
+    const char* kernel = "scalar";
+#endif
+    printf("CharScanner kernel: %s\n", kernel);
+    printf("%8s %14s %14s %14s\n", "length", "scalar MB/s", "vector MB/s", "parse MB/s");
+
+    const size_t lengths[] = {16, 64, 256, 1024, 4096};
+    for (size_t length : lengths) {
+        //long string argument, terminator is at the very end
+        string data(length, 'x');
+        data.back() = '"';
+        const size_t iterations = (64 * 1024 * 1024) / length;
+
+        const double scalar = measureMBps(scanStringRunScalar, data, iterations);
+        const double vector = measureMBps(scanStringRun, data, iterations);
+
+        string cmd = "CMD\"" + data;
+        const double parse = measureParseMBps(cmd, iterations);
+
+        printf("%8zu %14.1f %14.1f %14.1f\n", length, scalar, vector, parse);
+    }
+}
@@ -0,0 +1,14 @@
+/*
+ * CharScannerBenchmark.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef CharScannerBenchmark_hpp
+#define CharScannerBenchmark_hpp
+
+//Compares vector and scalar scanning on long string arguments, prints results to stdout
+void benchmarkCharScanner();
+
+#endif /* CharScannerBenchmark_hpp */
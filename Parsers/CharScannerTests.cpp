@@ -0,0 +1,61 @@
+/*
+ * CharScannerTests.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "CharScannerTests.hpp"
+#include "CharScanner.h"
+#include <string.h>
+#include <stdlib.h>
+
+static bool testMarkerAtEachPosition(char marker, char filler) {
+    //marker at every position of buffers longer than vector width, including tails
+    char buf[100];
+    bool testResult = true;
+    for (size_t length = 0; length < sizeof(buf); length++) {
+        memset(buf, filler, sizeof(buf));
+        testResult &= scanStringRun(buf, length) == scanStringRunScalar(buf, length);
+        testResult &= scanDelimiter(buf, length) == scanDelimiterScalar(buf, length);
+        testResult &= scanEndOfLine(buf, length) == scanEndOfLineScalar(buf, length);
+        for (size_t pos = 0; pos < length; pos++) {
+            buf[pos] = marker;
+            testResult &= scanStringRun(buf, length) == scanStringRunScalar(buf, length);
+            testResult &= scanDelimiter(buf, length) == scanDelimiterScalar(buf, length);
+            testResult &= scanEndOfLine(buf, length) == scanEndOfLineScalar(buf, length);
+            buf[pos] = filler;
+        }
+    }
+    return testResult;
+}
+
+static bool testKnownValues() {
+    bool testResult = true;
+    const char* str = "abcdefghijklmnopqrstuvwxyz0123456789\"end";
+    testResult &= scanStringRun(str, strlen(str)) == 36;
+    testResult &= scanDelimiter(str, strlen(str)) == 36;
+    testResult &= scanEndOfLine(str, strlen(str)) == strlen(str);
+
+    const char* digits = "1234567890123456789012345678901234567890,1)";
+    testResult &= scanDelimiter(digits, strlen(digits)) == 40;
+
+    const char* line = "RTH 21.5 45.0 ...........................\r\r";
+    testResult &= scanEndOfLine(line, strlen(line)) == strlen(line) - 2;
+
+    //bytes above #126 are invalid in strings
+    const char high[] = "0123456789abcdefghij\x80xyz";
+    testResult &= scanStringRun(high, strlen(high)) == 20;
+    return testResult;
+}
+
+bool testCharScanner() {
+    bool result = true;
+
+    result &= testKnownValues();
+    const char markers[] = {'"', ',', '(', ')', 13, 10, 0, 127, (char)0xC3, ' ', '~'};
+    for (size_t t = 0; t < sizeof(markers); t++) {
+        result &= testMarkerAtEachPosition(markers[t], 'a');
+    }
+    return result;
+}
@@ -0,0 +1,13 @@
+/*
+ * CharScannerTests.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef CharScannerTests_hpp
+#define CharScannerTests_hpp
+
+bool testCharScanner();
+
+#endif /* CharScannerTests_hpp */
@@ -0,0 +1,96 @@
+/*
+ * CommandId.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef CommandId_hpp
+#define CommandId_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+//3 letters command packed same way as MiniInParser does it: "CMD" -> 0x434d4400.
+//Declare ids as constexpr, then invalid name fails to compile:
+//  constexpr CommandId RTH_CMD("RTH");
+//Default constructed id is "no command", it's rejected by RemoteCommandBuilder. No exceptions are
+//used, so the header can be included in -fno-exceptions builds.
+class CommandId {
+    public:
+        constexpr CommandId()
+        : id(0) {
+        }
+
+        //invalid name fails compile time evaluation, at run time it gives "no command"
+        explicit constexpr CommandId(const char (&name)[4])
+        : id(isLetter(name[0]) && isLetter(name[1]) && isLetter(name[2])
+            ? ((uint32_t)(uint8_t) name[0] << 24) | ((uint32_t)(uint8_t) name[1] << 16) | ((uint32_t)(uint8_t) name[2] << 8)
+            : invalidName()) {
+        }
+
+        //Packed value coming from outside (parsers, storage), invalid one gives "no command"
+        static constexpr CommandId fromPacked(uint32_t packed) {
+            return isValidPacked(packed) == true ? CommandId(packed, 0) : CommandId();
+        }
+
+        static constexpr bool isValidPacked(uint32_t packed) {
+            return isLetter(packed >> 24) && isLetter(packed >> 16) && isLetter(packed >> 8) && (packed & 0xFF) == 0;
+        }
+
+        constexpr bool isValid() const {
+            return id != 0;
+        }
+
+        constexpr uint32_t value() const {
+            return id;
+        }
+
+        constexpr char charAt(int index) const {
+            return static_cast<char>(id >> (24 - 8 * index));
+        }
+
+        constexpr bool operator==(const CommandId& rhs) const {
+            return id == rhs.id;
+        }
+
+        constexpr bool operator!=(const CommandId& rhs) const {
+            return id != rhs.id;
+        }
+    private:
+        uint32_t id;
+
+        //unchecked, only for already validated values
+        constexpr CommandId(uint32_t packed, int)
+        : id(packed) {
+        }
+
+        static constexpr bool isLetter(uint32_t c) {
+            return (c & 0xFF) >= 'A' && (c & 0xFF) <= 'Z';
+        }
+
+        //not constexpr, so reaching it stops constant evaluation: "Only capital letters allowed!"
+        static uint32_t invalidName() {
+            return 0;
+        }
+};
+
+//Forces compile time evaluation also for temporaries, e.g. RemoteCommandBuilder b(COMMAND_ID("PWD"));
+#define COMMAND_ID(name) CommandId::fromPacked(std::integral_constant<uint32_t, CommandId(name).value()>::value)
+
+//Expected arguments of command, used by InParser to skip argument type discovery
+typedef enum {
+    CommandShape_NONE,                  //no arguments
+    CommandShape_DIGITS,                //single digit or digits sequence
+    CommandShape_STRINGS,               //single string or strings sequence
+    CommandShape_DIGIT_MULTI_SEQUENCE,
+    CommandShape_STRING_MULTI_SEQUENCE,
+} CommandShape;
+
+typedef struct {
+    CommandId       id;
+    CommandShape    shape;
+} CommandSchemaEntry;
+
+#endif /* CommandId_hpp */
@@ -6,8 +6,111 @@
  */
 
 #include "InParser.h"
-#include <sstream>
-#include <stdexcept>
+#include "CharScanner.h"
+#include <charconv>
+#include <math.h>
+
+const char* inParseErrorToString(InParseError error) {
+    static const char* names[InParseError_COUNT] = {
+        "NONE", "NO_CMD", "INVALID_CMD", "MALFORMED", "EXPECTED_QUOTE", "INVALID_STRING_CHAR",
+        "UNTERMINATED_STRING", "EXPECTED_DIGIT", "INVALID_DIGIT_CHAR", "TOO_MANY_DOTS", "EXPECTED_COMA",
+        "UNEXPECTED_END", "INVALID_SEQUENCE", "OUT_OF_RANGE", "UNKNOWN_CMD", "SCHEMA_MISMATCH"
+    };
+    return error < InParseError_COUNT ? names[error] : "UNKNOWN";
+}
+
+RemoteCommand::RemoteCommand()
+: argType(RemoteCommandArgumentType_NONE), count(0), valuesCount(0), sequenceOffsetsCount(0), arenaSize(0),
+  arenaUsed(0) {
+    cmd[0] = 0;
+}
+
+RemoteCommand::RemoteCommand(const RemoteCommand& source)
+: RemoteCommand() {
+    *this = source;
+}
+
+RemoteCommand& RemoteCommand::operator=(const RemoteCommand& source) {
+    if (this == &source) {
+        return *this;
+    }
+    memcpy(cmd, source.cmd, sizeof(cmd));
+    id = source.id;
+    argType = source.argType;
+    count = source.count;
+    allocateStorage(source.valuesCount, source.sequenceOffsetsCount, source.arenaSize);
+    arenaUsed = source.arenaUsed;
+    if (storage != nullptr) {
+        memcpy(storage.get(), source.storage.get(), storageSize());
+    }
+    return *this;
+}
+
+void RemoteCommand::allocateStorage(uint32_t values, uint32_t sequenceOffsets, uint32_t arena) {
+    valuesCount = values;
+    sequenceOffsetsCount = sequenceOffsets;
+    arenaSize = arena;
+    arenaUsed = 0;
+    const size_t size = storageSize();
+    storage.reset(size == 0 ? nullptr : new char[size]);
+}
+
+size_t RemoteCommand::storageSize() const {
+    return valuesCount * sizeof(Value) + sequenceOffsetsCount * sizeof(uint32_t) + arenaSize;
+}
+
+RemoteCommand::Value* RemoteCommand::values() const {
+    return reinterpret_cast<Value*>(storage.get());
+}
+
+uint32_t* RemoteCommand::sequenceOffsets() const {
+    return reinterpret_cast<uint32_t*>(storage.get() + valuesCount * sizeof(Value));
+}
+
+char* RemoteCommand::arena() const {
+    return storage.get() + valuesCount * sizeof(Value) + sequenceOffsetsCount * sizeof(uint32_t);
+}
+
+const Number RemoteCommand::toNumber(const Value& value) const {
+    switch (value.tag) {
+        case Value::DOUBLE:
+            return Number(value.doubleVal);
+        case Value::SIGNED_INT:
+            return Number(static_cast<int64_t>(value.intVal));
+        default:
+            return Number(value.intVal);
+    }
+}
+
+string_view RemoteCommand::toString(const Value& value) const {
+    return string_view(arena() + value.offset, value.length);
+}
+
+void RemoteCommand::appendNumber(uint32_t index, const Number& number) {
+    Value& value = values()[index];
+    if (number.isDouble() == true) {
+        value.tag = Value::DOUBLE;
+        value.doubleVal = number.asDouble();
+    } else if (number.isSigned() == true) {
+        value.tag = Value::SIGNED_INT;
+        value.intVal = number.asUInt64();
+    } else {
+        value.tag = Value::INT;
+        value.intVal = number.asUInt64();
+    }
+    value.length = 0;
+}
+
+void RemoteCommand::appendString(uint32_t index, string_view text) {
+    //strings are null terminated in arena, it's sized by parser so it always fits
+    Value& value = values()[index];
+    value.tag = Value::STRING;
+    value.offset = arenaUsed;
+    value.length = static_cast<uint32_t>(text.size());
+    memcpy(arena() + arenaUsed, text.data(), text.size());
+    arenaUsed += value.length;
+    arena()[arenaUsed++] = 0;
+}
 
 bool RemoteCommand::operator==(const char* rhs) {
     return strcmp(cmd, (const char*) rhs) == 0;
@@ -17,138 +120,304 @@ bool RemoteCommand::operator==(const string& rhs) {
     return strcmp(cmd, (const char*) rhs.c_str()) == 0;
 }
 
+bool RemoteCommand::operator==(const CommandId& rhs) {
+    return id == rhs;
+}
+
+const CommandId RemoteCommand::getCommandId() {
+    return id;
+}
+
 const RemoteCommandArgumentType RemoteCommand::getArgType() {
     return argType;
 }
 
 const Number RemoteCommand::argument(int index) {
-  return numericValues[index];
+  return toNumber(values()[index]);
 }
 
 const int64_t RemoteCommand::argumentAsInt(int index) {
-  return numericValues[index].asInt64();
+  return argument(index).asInt64();
 }
 
 const uint64_t RemoteCommand::argumentAsUInt(int index) {
-  return numericValues[index].asUInt64();
+  return argument(index).asUInt64();
 }
 
 const double RemoteCommand::argumentAsDouble(int index) {
-  return numericValues[index].asDouble();
+  return argument(index).asDouble();
 }
 
 shared_ptr<string> RemoteCommand::stringArgument(int index) {
-  return stringValues[index];
+  return make_shared<string>(stringArgumentView(index));
+}
+
+string_view RemoteCommand::stringArgumentView(int index) {
+  return toString(values()[index]);
 }
 
 const unsigned long RemoteCommand::argumentsCount() {
-  //not only one of those structures can be non 0, thats why I can add them
-  return numericValues.size() + stringValues.size() + numericSeries.size() + stringSeries.size();
+  return count;
 }
 
-shared_ptr<vector<Number> > RemoteCommand::getDigitSequence(int index) {
-  return numericSeries[index];
+const unsigned long RemoteCommand::getSequenceLength(int index) {
+  //plain commands have no offsets, so there is no sequence to measure
+  if (index < 0 || (uint32_t) index + 1 >= sequenceOffsetsCount) {
+    return 0;
+  }
+  return sequenceOffsets()[index + 1] - sequenceOffsets()[index];
 }
 
-shared_ptr<vector<shared_ptr<string> > > RemoteCommand::getStringSequence(int index) {
-  return stringSeries[index];
+const Number RemoteCommand::sequenceArgument(int sequence, int index) {
+  return toNumber(values()[sequenceOffsets()[sequence] + index]);
 }
 
-InParser::InParser() {
+string_view RemoteCommand::sequenceStringArgument(int sequence, int index) {
+  return toString(values()[sequenceOffsets()[sequence] + index]);
+}
 
+shared_ptr<vector<Number> > RemoteCommand::getDigitSequence(int index) {
+  shared_ptr<vector<Number> > result = make_shared<vector<Number> >();
+  const unsigned long length = getSequenceLength(index);
+  result->reserve(length);
+  for (unsigned long t = 0; t < length; t++) {
+    result->push_back(sequenceArgument(index, t));
+  }
+  return result;
 }
 
-InParser::~InParser() {
+shared_ptr<vector<shared_ptr<string> > > RemoteCommand::getStringSequence(int index) {
+  shared_ptr<vector<shared_ptr<string> > > result = make_shared<vector<shared_ptr<string> > >();
+  const unsigned long length = getSequenceLength(index);
+  result->reserve(length);
+  for (unsigned long t = 0; t < length; t++) {
+    result->push_back(make_shared<string>(sequenceStringArgument(index, t)));
+  }
+  return result;
+}
+
+RemoteArgument::RemoteArgument()
+: isString(false), isFloat(false), sequenceIndex(0), nextPosition(0) {
 }
 
-void InParser::parseCmd(istringstream& stream, shared_ptr<RemoteCommand> outCmd) {
-    stream.read((char*)outCmd->cmd, 3);
-    if (stream.eof()) {
-        throw invalid_argument("Not enough data to form cmd");
+//Accumulates digits with optional leading '-', false if value doesn't fit into int64/uint64
+static bool parseInteger(const char* first, const char* last, uint64_t& outValue, bool& outNegative) {
+    outNegative = first != last && *first == '-';
+    if (outNegative == true) {
+        first++;
     }
-    outCmd->cmd[3] = 0;
-    for(int t = 0; t < 3; t++) {
-        const char c = outCmd->cmd[t];
-        if (c < 'A' || c > 'Z') {
-            throw invalid_argument("Invalid character in CMD, allowed only A-Z");
+    uint64_t value = 0;
+    for (; first != last; first++) {
+        const unsigned digit = *first - '0';
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    outValue = value;
+    //magnitude of INT64_MIN is one more than INT64_MAX
+    return outNegative == false || value <= static_cast<uint64_t>(INT64_MAX) + 1;
+}
+
+//from_chars reports overflow and underflow the same way. Grammar has no exponent, so value
+//overflows only when its integer part has non zero digit, otherwise it's too close to 0.
+static double outOfRangeDouble(const char* first, const char* last) {
+    const bool negative = first != last && *first == '-';
+    for (const char* c = negative == true ? first + 1 : first; c != last && *c != '.'; c++) {
+        if (*c != '0') {
+            return negative == true ? -HUGE_VAL : HUGE_VAL;
         }
     }
+    return negative == true ? -0.0 : 0.0;
 }
 
-shared_ptr<string> InParser::handleSingleString(istringstream& stream) {
-    char tmp;
-    stream.read(&tmp, 1);
+const Number RemoteArgument::asNumber() const {
+    const char* first = text.data();
+    const char* last = first + text.size();
 
-    if (tmp != '"' || stream.eof()) {
-        throw invalid_argument("Invalid character expected '\"' on beginning of string argument");
+    if (isFloat == true) {
+        //exact and locale independent, tokens without any digit (like "-.") are 0
+        double value = 0;
+        if (from_chars(first, last, value).ec == errc::result_out_of_range) {
+            value = outOfRangeDouble(first, last);
+        }
+        return Number(value);
     }
-    shared_ptr<string> arg = make_shared<string>();
-    while(true) {
-        stream.read(&tmp, 1);
-        if (stream.eof()) {
-            throw invalid_argument("Unexpected end of data while parsing string");
 
-        } else if (tmp < ' ' || tmp > '~') {
-            throw invalid_argument("Invalid character accepted range is #32-#126 in string argument");
+    //range is validated by parser
+    uint64_t value = 0;
+    bool negative = false;
+    parseInteger(first, last, value, negative);
+    if (negative == true) {
+        return Number(static_cast<int64_t>(0 - value));
+    }
+    return Number(value);
+}
+
+RemoteCommandView::RemoteCommandView()
+: argType(RemoteCommandArgumentType_NONE), count(0), values(0) {
+    cmd[0] = 0;
+}
+
+bool RemoteCommandView::operator==(const char* rhs) const {
+    return strcmp(cmd, rhs) == 0;
+}
+
+bool RemoteCommandView::operator==(const string& rhs) const {
+    return strcmp(cmd, rhs.c_str()) == 0;
+}
+
+bool RemoteCommandView::operator==(const CommandId& rhs) const {
+    return id == rhs;
+}
+
+const CommandId RemoteCommandView::getCommandId() const {
+    return id;
+}
 
-        } else if (tmp == '"') {
+const RemoteCommandArgumentType RemoteCommandView::getArgType() const {
+    return argType;
+}
+
+const unsigned long RemoteCommandView::argumentsCount() const {
+    return count;
+}
+
+const unsigned long RemoteCommandView::valuesCount() const {
+    return values;
+}
+
+bool RemoteCommandView::nextArgument(RemoteArgument& arg) const {
+    //arguments are already validated by parser, so only separators need to be skipped
+    size_t pos = arg.nextPosition;
+    while (pos < arguments.size()) {
+        const char c = arguments[pos];
+        if (c == '(' && pos != 0) {
+            arg.sequenceIndex++;
+
+        } else if (c != '(' && c != ')' && c != ',') {
             break;
         }
+        pos++;
+    }
+    if (pos >= arguments.size()) {
+        return false;
+    }
+
+    size_t end;
+    if (arguments[pos] == '"') {
+        pos++;
+        end = arguments.find('"', pos);
+        arg.nextPosition = end + 1;
+        arg.isString = true;
+        arg.isFloat = false;
 
-        arg->push_back( tmp );
+    } else {
+        end = pos + scanDelimiter(arguments.data() + pos, arguments.size() - pos);
+        arg.nextPosition = end;
+        arg.isString = false;
+        arg.isFloat = arguments.substr(pos, end - pos).find('.') != string_view::npos;
     }
-    return arg;
+    arg.text = arguments.substr(pos, end - pos);
+    return true;
 }
 
-void InParser::handleStringArgument(istringstream& stream, shared_ptr<RemoteCommand> outCmd) {
-    outCmd->argType = RemoteCommandArgumentType_STRING;
-    while(true) {
-        shared_ptr<string> str = handleSingleString(stream);
-        outCmd->stringValues.push_back(str);
+InParser::InParser()
+: schema(nullptr), schemaSize(0) {
 
-        if (stream.eof()) {
-            return;
+}
+
+InParser::InParser(const CommandSchemaEntry* schema, size_t schemaSize)
+: schema(schema), schemaSize(schemaSize) {
+}
+
+InParser::~InParser() {
+}
+
+const CommandSchemaEntry* InParser::findSchema(CommandId id) const {
+    //schemas are short, comparing packed ids is cheaper than any hashing
+    for (size_t t = 0; t < schemaSize; t++) {
+        if (schema[t].id == id) {
+            return &schema[t];
         }
-        char c;
-        stream.read(&c, 1);
-        if (stream.eof()) {
-            return;
+    }
+    return nullptr;
+}
+
+InParseError InParser::parseCmd(string_view& stream, RemoteCommandView& outCmd) {
+    uint32_t id = 0;
+    for(size_t t = 0; t < 3; t++) {
+        if (stream.size() <= t) {
+            stream.remove_prefix(stream.size());
+            return InParseError_NO_CMD;
         }
-        if (c != ',') {
-            throw invalid_argument("Invalid character expected ',' in string sequence");
+        const char c = stream[t];
+        if (c < 'A' || c > 'Z') {
+            stream.remove_prefix(t);
+            return InParseError_INVALID_CMD;
         }
-        outCmd->argType = RemoteCommandArgumentType_STRING_SEQUENCE;
+        outCmd.cmd[t] = c;
+        id = (id | c) << 8;
     }
+    outCmd.cmd[3] = 0;
+    outCmd.id = CommandId::fromPacked(id);
+    stream.remove_prefix(3);
+    return InParseError_NONE;
 }
 
-Number InParser::handleSingleDigit(istringstream& stream) {
-    stringstream tmpStream;
-    bool isFloat = false;
-    bool firstChar = true;
+InParseError InParser::handleSingleString(string_view& stream) {
+    if (stream.empty() || stream[0] != '"') {
+        return InParseError_EXPECTED_QUOTE;
+    }
+    const size_t t = 1 + scanStringRun(stream.data() + 1, stream.size() - 1);
+    if (t == stream.size()) {
+        stream.remove_prefix(t);
+        return InParseError_UNTERMINATED_STRING;
+    }
+    if (stream[t] != '"') {
+        stream.remove_prefix(t);
+        return InParseError_INVALID_STRING_CHAR;
+    }
+    stream.remove_prefix(t + 1);
+    return InParseError_NONE;
+}
 
+InParseError InParser::handleStringArgument(string_view& stream, RemoteCommandView& outCmd) {
+    outCmd.argType = RemoteCommandArgumentType_STRING;
     while(true) {
-        int peek = stream.peek();
-        if (peek == ',' || peek == ')') {
-            if (firstChar == true) {
-                throw invalid_argument("Expected digit here!");
-            }
-            break;
+        InParseError error = handleSingleString(stream);
+        if (error != InParseError_NONE) {
+            return error;
         }
-        char c;
-        stream.read(&c, 1);
-      
-        if (stream.eof()) {
-            if (firstChar == true) {
-                throw invalid_argument("Expected digit here!");
-            }
+        outCmd.count++;
+
+        if (stream.empty()) {
+            return InParseError_NONE;
+        }
+        if (stream[0] != ',') {
+            return InParseError_EXPECTED_COMA;
+        }
+        stream.remove_prefix(1);
+        outCmd.argType = RemoteCommandArgumentType_STRING_SEQUENCE;
+    }
+}
+
+InParseError InParser::handleSingleDigit(string_view& stream) {
+    bool isFloat = false;
+    bool firstChar = true;
+    size_t t = 0;
+
+    for(; t < stream.size(); t++) {
+        const char c = stream[t];
+        if (c == ',' || c == ')') {
             break;
         }
-      
+
         if (c == '.') {
             if (isFloat == true) {
-                throw invalid_argument("To many '.'");
+                stream.remove_prefix(t);
+                return InParseError_TOO_MANY_DOTS;
             }
-            tmpStream << '.';
             isFloat = true;
             continue;
         }
@@ -156,143 +425,223 @@ Number InParser::handleSingleDigit(istringstream& stream) {
         if (firstChar == true) {
           firstChar = false;   //it can be only at first char
           if (c == '-') {
-            tmpStream << '-';
             continue;
           }
         }
         if (c >= '0' && c <= '9') {
-            tmpStream << c;
             continue;
         }
-      
-        throw invalid_argument("Invalid character in digit.");
-    }
 
-    if (isFloat == true) {
-        double tmp = strtod(tmpStream.str().c_str(), nullptr);
-        return Number(tmp);
+        stream.remove_prefix(t);
+        return InParseError_INVALID_DIGIT_CHAR;
+    }
+    if (firstChar == true) {
+        return InParseError_EXPECTED_DIGIT;
+    }
 
-    } else {
-        uint64_t tmp = strtoull(tmpStream.str().c_str(), nullptr, 10);
-        return Number(tmp);
+    if (isFloat == false) {
+        uint64_t value;
+        bool negative;
+        if (parseInteger(stream.data(), stream.data() + t, value, negative) == false) {
+            return InParseError_OUT_OF_RANGE;
+        }
     }
+    stream.remove_prefix(t);
+    return InParseError_NONE;
 }
 
-void InParser::handleDigitArgument(istringstream& stream, shared_ptr<RemoteCommand> outCmd) {
-    outCmd->argType = RemoteCommandArgumentType_DIGIT;
+InParseError InParser::handleDigitArgument(string_view& stream, RemoteCommandView& outCmd) {
+    outCmd.argType = RemoteCommandArgumentType_DIGIT;
     while (true) {
-        Number n = handleSingleDigit(stream);
-        outCmd->numericValues.push_back(n);
+        InParseError error = handleSingleDigit(stream);
+        if (error != InParseError_NONE) {
+            return error;
+        }
+        outCmd.count++;
 
-        if (stream.eof()) {
-            return;
+        if (stream.empty()) {
+            return InParseError_NONE;
         }
-        char c;
-        stream.read(&c, 1);
-        if (c != ',') {
-            throw invalid_argument("Invalid character expected ',' in digit sequence");
+        if (stream[0] != ',') {
+            return InParseError_EXPECTED_COMA;
         }
-        outCmd->argType = RemoteCommandArgumentType_DIGIT_SEQUENCE;
+        stream.remove_prefix(1);
+        outCmd.argType = RemoteCommandArgumentType_DIGIT_SEQUENCE;
     }
 }
 
-void InParser::handleSequence(istringstream& stream, shared_ptr<RemoteCommand> outCmd) {
-    char c;
-    stream.read(&c, 1);  //read '('
-    //discover if this is sequence of strings or digits?
-    int peek = stream.peek();
-    if (peek == EOF) {
-        throw invalid_argument("Unexpected end of stream!");
-    }
-
-    bool isStrSeq = peek == '"';
-    outCmd->argType = isStrSeq ? RemoteCommandArgumentType_STRING_MULTI_SEQUENCE : RemoteCommandArgumentType_DIGIT_MULTI_SEQUENCE;
-    shared_ptr<vector<Number> > numberSeq = nullptr;
-    shared_ptr<vector<shared_ptr<string> > > stringSeq = nullptr;
+InParseError InParser::handleSequence(string_view& stream, RemoteCommandView& outCmd, bool isStrSeq) {
+    stream.remove_prefix(1);  //skip '('
+    outCmd.argType = isStrSeq ? RemoteCommandArgumentType_STRING_MULTI_SEQUENCE : RemoteCommandArgumentType_DIGIT_MULTI_SEQUENCE;
 
     while( true ) {
-        if (isStrSeq == true) {
-            shared_ptr<string> tmp = handleSingleString(stream);
-            if (stringSeq == nullptr) {
-                stringSeq = make_shared< vector<shared_ptr<string> > >();
-            }
-            stringSeq->push_back(tmp);
-
-        } else {
-            Number tmp = handleSingleDigit(stream);
-            if (numberSeq == nullptr) {
-                numberSeq = make_shared<vector<Number> >();
-            }
-            numberSeq->push_back(tmp);
+        InParseError error = isStrSeq ? handleSingleString(stream) : handleSingleDigit(stream);
+        if (error != InParseError_NONE) {
+            return error;
         }
+        outCmd.values++;
 
-        stream.read(&c, 1);
-        if (stream.eof() == true) {
-            throw invalid_argument("Unexpected end of stream!");
+        if (stream.empty()) {
+            return InParseError_UNEXPECTED_END;
         }
+        char c = stream[0];
         if (c == ',') {
             //next element in sequence
+            stream.remove_prefix(1);
             continue;
         }
 
-        if (c == ')') {
-            //end of subsequence
-            if (isStrSeq) {
-                outCmd->stringSeries.push_back(stringSeq);
-                stringSeq = nullptr;
-            } else {
-                outCmd->numericSeries.push_back(numberSeq);
-                numberSeq = nullptr;
-            }
+        if (c != ')') {
+            return InParseError_INVALID_SEQUENCE;
+        }
+        //end of subsequence
+        outCmd.count++;
+        stream.remove_prefix(1);
 
-            stream.read(&c, 1);
-            if (stream.eof() == true) {
-                return; //end of sequence
-            }
+        if (stream.empty()) {
+            return InParseError_NONE; //end of sequence
+        }
 
-            if (c == '(') {
-                //new sub sequence
-                continue;
-            }
+        if (stream[0] != '(') {
+            return InParseError_INVALID_SEQUENCE;
         }
+        //new sub sequence
+        stream.remove_prefix(1);
+    }
+}
 
-        throw invalid_argument("Illegal character in sequence!");
+InParseError InParser::handleArguments(string_view& stream, RemoteCommandView& outCmd) {
+    if (stream.empty() == true) {
+        return InParseError_NONE;
+    }
+    const char nextChar = stream[0];
+    if (nextChar == '"') {
+        //string
+        return handleStringArgument(stream, outCmd);
+
+    } else if (nextChar == '-' || (nextChar >= '0' && nextChar <= '9')) {
+        //digit
+        return handleDigitArgument(stream, outCmd);
+
+    } else if (nextChar == '(') {
+        //sequence, discover if this is sequence of strings or digits?
+        if (stream.size() == 1) {
+            stream.remove_prefix(1);
+            return InParseError_UNEXPECTED_END;
+        }
+        return handleSequence(stream, outCmd, stream[1] == '"');
     }
+    //malformed
+    return InParseError_MALFORMED;
 }
 
-shared_ptr<RemoteCommand> InParser::parse(shared_ptr<string> data) {
-    shared_ptr<RemoteCommand> result = make_shared<RemoteCommand>();
+InParseError InParser::handleSchemaArguments(string_view& stream, RemoteCommandView& outCmd, CommandShape shape) {
+    //shape is known, so only first byte is checked and decoder is picked directly
+    switch (shape) {
+        case CommandShape_NONE:
+            return stream.empty() ? InParseError_NONE : InParseError_SCHEMA_MISMATCH;
 
-    try {
-        istringstream stream(*data);
-        parseCmd(stream, result);
-        int tmp = stream.peek();
-        if (tmp == EOF) {
-            result->argType = RemoteCommandArgumentType_NONE;
+        case CommandShape_DIGITS:
+            if (stream.empty() == true || (stream[0] != '-' && (stream[0] < '0' || stream[0] > '9'))) {
+                return InParseError_SCHEMA_MISMATCH;
+            }
+            return handleDigitArgument(stream, outCmd);
 
-        } else {
-            const char nextChar = static_cast<const char>(tmp);
-            if (nextChar == '"') {
-                //string
-                handleStringArgument(stream, result);
+        case CommandShape_STRINGS:
+            if (stream.empty() == true || stream[0] != '"') {
+                return InParseError_SCHEMA_MISMATCH;
+            }
+            return handleStringArgument(stream, outCmd);
 
-            } else if (nextChar == '-' || (nextChar >= '0' && nextChar <= '9')) {
-                //digit
-                handleDigitArgument(stream, result);
+        case CommandShape_DIGIT_MULTI_SEQUENCE:
+        case CommandShape_STRING_MULTI_SEQUENCE:
+            if (stream.empty() == true || stream[0] != '(') {
+                return InParseError_SCHEMA_MISMATCH;
+            }
+            return handleSequence(stream, outCmd, shape == CommandShape_STRING_MULTI_SEQUENCE);
+    }
+    return InParseError_SCHEMA_MISMATCH;
+}
 
-            } else if (nextChar == '(') {
-                //sequence
-                handleSequence(stream, result);
+InParseResult InParser::parse(string_view data, RemoteCommandView& outCmd) {
+    outCmd.argType = RemoteCommandArgumentType_NONE;
+    outCmd.count = 0;
+    outCmd.values = 0;
 
+    string_view stream = data;
+    InParseError error = parseCmd(stream, outCmd);
+    if (error == InParseError_NONE) {
+        outCmd.arguments = stream;
+        if (schema == nullptr) {
+            error = handleArguments(stream, outCmd);
+
+        } else {
+            const CommandSchemaEntry* entry = findSchema(outCmd.id);
+            if (entry == nullptr) {
+                //offset points to beginning of command
+                stream = data;
+                error = InParseError_UNKNOWN_CMD;
             } else {
-                //malformed
-                throw invalid_argument("Malformed request");
+                error = handleSchemaArguments(stream, outCmd, entry->shape);
             }
         }
+    }
+
+    if (error != InParseError_NONE) {
+        return InParseResult{error, data.size() - stream.size()};
+    }
+    if (outCmd.values == 0) {
+        outCmd.values = outCmd.count;
+    }
+    return InParseResult{InParseError_NONE, 0};
+}
 
-    } catch (...) {
+shared_ptr<RemoteCommand> InParser::parse(shared_ptr<string> data, InParseResult* outResult) {
+    RemoteCommandView view;
+    InParseResult parseResult = parse(string_view(*data), view);
+    if (outResult != nullptr) {
+        *outResult = parseResult;
+    }
+    if (parseResult.error != InParseError_NONE) {
         return nullptr;
     }
 
+    shared_ptr<RemoteCommand> result = make_shared<RemoteCommand>();
+    memcpy(result->cmd, view.cmd, sizeof(result->cmd));
+    result->id = view.id;
+    result->argType = view.argType;
+    result->count = view.count;
+
+    const bool isMulti = view.argType == RemoteCommandArgumentType_DIGIT_MULTI_SEQUENCE ||
+        view.argType == RemoteCommandArgumentType_STRING_MULTI_SEQUENCE;
+    const bool isString = view.argType == RemoteCommandArgumentType_STRING ||
+        view.argType == RemoteCommandArgumentType_STRING_SEQUENCE ||
+        view.argType == RemoteCommandArgumentType_STRING_MULTI_SEQUENCE;
+    //each string has at least two '"' around, so raw arguments length is enough also for null terminators
+    result->allocateStorage(view.values, isMulti ? view.count + 1 : 0,
+        isString ? view.arguments.size() : 0);
+
+    RemoteArgument arg;
+    uint32_t index = 0;
+    unsigned long sequence = 0;
+    if (isMulti == true) {
+        result->sequenceOffsets()[0] = 0;
+    }
+    while (view.nextArgument(arg) == true) {
+        if (arg.sequenceIndex != sequence) {
+            sequence = arg.sequenceIndex;
+            result->sequenceOffsets()[sequence] = index;
+        }
+        if (isString == true) {
+            result->appendString(index, arg.text);
+        } else {
+            result->appendNumber(index, arg.asNumber());
+        }
+        index++;
+    }
+    if (isMulti == true) {
+        result->sequenceOffsets()[view.count] = index;
+    }
+
     return result;
 }
@@ -9,9 +9,11 @@
 #define InParser_hpp
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <string.h>
 #include "Number.hpp"
+#include "CommandId.hpp"
 
 using namespace std;
 
@@ -27,12 +29,46 @@ typedef enum {
     RemoteCommandArgumentType_STRING_MULTI_SEQUENCE
 } RemoteCommandArgumentType;
 
+typedef enum {
+    InParseError_NONE,
+    InParseError_NO_CMD,                //not enough data to form command
+    InParseError_INVALID_CMD,           //command is not made by [A-Z] symbols
+    InParseError_MALFORMED,             //argument is not a string, digit or sequence
+    InParseError_EXPECTED_QUOTE,        //'"' expected on beginning of string
+    InParseError_INVALID_STRING_CHAR,   //accepted range is #32-#126 in string argument
+    InParseError_UNTERMINATED_STRING,   //no closing '"'
+    InParseError_EXPECTED_DIGIT,        //empty digit
+    InParseError_INVALID_DIGIT_CHAR,    //not [0-9], '-' or '.' in digit
+    InParseError_TOO_MANY_DOTS,
+    InParseError_EXPECTED_COMA,         //',' expected between arguments
+    InParseError_UNEXPECTED_END,        //sequence is not closed
+    InParseError_INVALID_SEQUENCE,      //only '(' is allowed after ')'
+    InParseError_OUT_OF_RANGE,          //integer doesn't fit into int64 (negative) or uint64
+    InParseError_UNKNOWN_CMD,           //command is not in parser schema
+    InParseError_SCHEMA_MISMATCH,       //arguments don't match shape declared in schema
+    InParseError_COUNT
+} InParseError;
+
+typedef struct {
+    InParseError    error;
+    size_t          offset;     //offset of byte which caused error, 0 on success
+} InParseResult;
+
+const char* inParseErrorToString(InParseError error);
+
+//All values, subsequence offsets and strings are kept in one memory block
 class RemoteCommand {
     friend class InParser;
     public:
+        RemoteCommand();
+        RemoteCommand(const RemoteCommand& source);
+        RemoteCommand& operator=(const RemoteCommand& source);
+
         bool operator==(const char* rhs);
         bool operator==(const string& rhs);
+        bool operator==(const CommandId& rhs);
   
+        const CommandId getCommandId();
         const RemoteCommandArgumentType getArgType();
   
         const Number argument(int index = 0);
@@ -40,32 +76,121 @@ class RemoteCommand {
         const uint64_t argumentAsUInt(int index = 0);
         const double argumentAsDouble(int index = 0);
         shared_ptr<string> stringArgument(int index = 0);
+        string_view stringArgumentView(int index = 0);
   
+        //those two are building containers on each call, prefer sequenceArgument/sequenceStringArgument
         shared_ptr<vector<Number> > getDigitSequence(int index = 0);
         shared_ptr<vector<shared_ptr<string> > > getStringSequence(int index = 0);
+
+        //0 for plain commands and for index out of sequences range
+        const unsigned long getSequenceLength(int index = 0);
+        const Number sequenceArgument(int sequence, int index);
+        string_view sequenceStringArgument(int sequence, int index);
   
         const unsigned long argumentsCount();
     private:
+        struct Value {
+            enum Tag : uint8_t {INT, SIGNED_INT, DOUBLE, STRING} tag;
+            uint32_t length;    //only for STRING
+            union {
+                uint64_t intVal;
+                double doubleVal;
+                uint32_t offset;    //only for STRING, offset in strings arena
+            };
+        };
+
         char cmd[4];
+        CommandId id;
         RemoteCommandArgumentType argType;
-        vector<Number> numericValues;
-        vector<shared_ptr<string> >  stringValues;
-        vector<shared_ptr<vector<Number> > > numericSeries;
-        vector<shared_ptr<vector<shared_ptr <string> > > > stringSeries;
+        unsigned long count;
+        //[Value x valuesCount][uint32_t x sequencesOffsetsCount][char x arenaSize]
+        unique_ptr<char[]> storage;
+        uint32_t valuesCount;
+        uint32_t sequenceOffsetsCount;
+        uint32_t arenaSize;
+        uint32_t arenaUsed;
+
+        void allocateStorage(uint32_t values, uint32_t sequenceOffsets, uint32_t arena);
+        size_t storageSize() const;
+        Value* values() const;
+        uint32_t* sequenceOffsets() const;
+        char* arena() const;
+        const Number toNumber(const Value& value) const;
+        string_view toString(const Value& value) const;
+        void appendNumber(uint32_t index, const Number& number);
+        void appendString(uint32_t index, string_view text);
 };
 
+//Single argument of RemoteCommandView, text points into buffer passed to InParser::parse
+class RemoteArgument {
+    friend class RemoteCommandView;
+    public:
+        RemoteArgument();
+
+        string_view text;   //for strings it's content without '"'
+        bool isString;
+        bool isFloat;
+        unsigned long sequenceIndex;    //index of subsequence, used only with *_MULTI_SEQUENCE
+
+        const Number asNumber() const;
+    private:
+        size_t nextPosition;
+};
+
+//Non owning result of InParser, valid as long as parsed buffer is alive
+class RemoteCommandView {
+    friend class InParser;
+    public:
+        RemoteCommandView();
+
+        bool operator==(const char* rhs) const;
+        bool operator==(const string& rhs) const;
+        bool operator==(const CommandId& rhs) const;
+
+        const CommandId getCommandId() const;
+        const RemoteCommandArgumentType getArgType() const;
+        const unsigned long argumentsCount() const;
+        //all digits/strings in command, including those in subsequences
+        const unsigned long valuesCount() const;
+
+        //Walks arguments in order of appearance, start with default constructed RemoteArgument
+        bool nextArgument(RemoteArgument& arg) const;
+    private:
+        char cmd[4];
+        CommandId id;
+        RemoteCommandArgumentType argType;
+        string_view arguments;
+        unsigned long count;
+        unsigned long values;
+};
+
+//Parser never throws, failures are reported with InParseResult
 class InParser {
     public:
         InParser();
+        //only commands from schema are accepted, their arguments are decoded without type discovery
+        InParser(const CommandSchemaEntry* schema, size_t schemaSize);
+        template<size_t N> InParser(const CommandSchemaEntry (&schema)[N])
+        : InParser(schema, N) {
+        }
         virtual ~InParser();
-        shared_ptr<RemoteCommand> parse(shared_ptr<string> data);
+        shared_ptr<RemoteCommand> parse(shared_ptr<string> data, InParseResult* outResult = nullptr);
+        //no allocations, outCmd points into data
+        InParseResult parse(string_view data, RemoteCommandView& outCmd);
     private:
-        void parseCmd(istringstream& stream, shared_ptr<RemoteCommand> outCmd);
-        void handleStringArgument(istringstream& stream, shared_ptr<RemoteCommand> outCmd);
-        shared_ptr<string> handleSingleString(istringstream& stream);
-        void handleDigitArgument(istringstream& stream, shared_ptr<RemoteCommand> outCmd);
-        Number handleSingleDigit(istringstream& stream);
-        void handleSequence(istringstream& stream, shared_ptr<RemoteCommand> outCmd);
+        const CommandSchemaEntry* schema;
+        size_t schemaSize;
+
+        const CommandSchemaEntry* findSchema(CommandId id) const;
+        //on error stream is left at byte which caused it
+        InParseError parseCmd(string_view& stream, RemoteCommandView& outCmd);
+        InParseError handleArguments(string_view& stream, RemoteCommandView& outCmd);
+        InParseError handleSchemaArguments(string_view& stream, RemoteCommandView& outCmd, CommandShape shape);
+        InParseError handleStringArgument(string_view& stream, RemoteCommandView& outCmd);
+        InParseError handleSingleString(string_view& stream);
+        InParseError handleDigitArgument(string_view& stream, RemoteCommandView& outCmd);
+        InParseError handleSingleDigit(string_view& stream);
+        InParseError handleSequence(string_view& stream, RemoteCommandView& outCmd, bool isStrSeq);
 };
 
 #endif /* InParser_hpp */
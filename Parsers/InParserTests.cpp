@@ -324,6 +324,180 @@ static bool testIntFixedParamCmd() {
     return testResult;
 }
 
+static bool testFlatAccessors() {
+  shared_ptr<RemoteCommand> cmd;
+  bool testResult = true;
+  InParser parser;
+
+  cmd = parser.parse( make_shared<string>("CMD(\"a\",\"bc\")(\"def\")"));
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(0) == 2);
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(1) == 1);
+  testResult &= (cmd != nullptr) && (cmd->sequenceStringArgument(0, 1) == "bc");
+  testResult &= (cmd != nullptr) && (cmd->sequenceStringArgument(1, 0) == "def");
+
+  cmd = parser.parse( make_shared<string>("CMD(1,-2)(3.5)"));
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(0) == 2);
+  testResult &= (cmd != nullptr) && (cmd->sequenceArgument(0, 1).asInt() == -2);
+  testResult &= (cmd != nullptr) && (cmd->sequenceArgument(1, 0).asDouble() == 3.5);
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(2) == 0);
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(-1) == 0);
+  testResult &= (cmd != nullptr) && (cmd->getDigitSequence(2)->empty() == true);
+
+  cmd = parser.parse( make_shared<string>("CMD\"x\",\"yz\""));
+  testResult &= (cmd != nullptr) && (cmd->stringArgumentView(1) == "yz");
+  //not a sequence command
+  testResult &= (cmd != nullptr) && (cmd->getSequenceLength(0) == 0);
+  testResult &= (cmd != nullptr) && (cmd->getStringSequence(0)->empty() == true);
+
+  if (cmd != nullptr) {
+    //copy must not share arena with source
+    RemoteCommand copy(*cmd);
+    cmd = nullptr;
+    testResult &= copy.stringArgumentView(0) == "x";
+    testResult &= copy.argumentsCount() == 2;
+  }
+
+  return testResult;
+}
+
+static bool expectError(InParser& parser, const char* data, InParseError error, size_t offset) {
+  RemoteCommandView view;
+  InParseResult result = parser.parse(string_view(data), view);
+  return result.error == error && result.offset == offset;
+}
+
+static bool testErrorCodes() {
+  bool testResult = true;
+  InParser parser;
+  RemoteCommandView view;
+
+  testResult &= parser.parse(string_view("CMD(1,2)"), view).error == InParseError_NONE;
+  testResult &= view.getArgType() == RemoteCommandArgumentType_DIGIT_MULTI_SEQUENCE;
+
+  testResult &= expectError(parser, "", InParseError_NO_CMD, 0);
+  testResult &= expectError(parser, "CM", InParseError_NO_CMD, 2);
+  testResult &= expectError(parser, "C1D", InParseError_INVALID_CMD, 1);
+  testResult &= expectError(parser, "CMDinv", InParseError_MALFORMED, 3);
+  testResult &= expectError(parser, "CMD\"a\x10\"", InParseError_INVALID_STRING_CHAR, 5);
+  testResult &= expectError(parser, "CMD\"sdsad", InParseError_UNTERMINATED_STRING, 9);
+  testResult &= expectError(parser, "CMD\"ok\",0", InParseError_EXPECTED_QUOTE, 8);
+  testResult &= expectError(parser, "CMD123,,0", InParseError_EXPECTED_DIGIT, 7);
+  testResult &= expectError(parser, "CMD12x2", InParseError_INVALID_DIGIT_CHAR, 5);
+  testResult &= expectError(parser, "CMD123.1.2", InParseError_TOO_MANY_DOTS, 8);
+  testResult &= expectError(parser, "CMD\"a\"\"", InParseError_EXPECTED_COMA, 6);
+  testResult &= expectError(parser, "CMD(1,2", InParseError_UNEXPECTED_END, 7);
+  testResult &= expectError(parser, "CMD(1,2),(1)", InParseError_INVALID_SEQUENCE, 8);
+
+  //reason is also available for shared_ptr variant
+  InParseResult result;
+  testResult &= parser.parse(make_shared<string>("CMD()(1,1)"), &result) == nullptr;
+  testResult &= result.error == InParseError_EXPECTED_DIGIT && result.offset == 4;
+
+  return testResult;
+}
+
+static bool testNumberRanges() {
+  shared_ptr<RemoteCommand> cmd;
+  bool testResult = true;
+  InParser parser;
+
+  //negative values are kept signed
+  cmd = parser.parse( make_shared<string>("CMD-5"));
+  testResult &= (cmd != nullptr) && cmd->argument().isSigned();
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble() == -5.0);
+
+  cmd = parser.parse( make_shared<string>("CMD-9223372036854775808"));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsInt() == INT64_MIN);
+
+  //only negative values are signed, whatever type they were built from
+  testResult &= Number(5).isSigned() == false;
+  testResult &= Number(0).isSigned() == false;
+  testResult &= Number((int64_t) 7).isSigned() == false;
+  testResult &= Number(-5).isSigned() == true;
+  testResult &= Number(-5).asDouble() == -5.0;
+  testResult &= Number((int64_t) -7).asInt64() == -7;
+
+  //too small for int64
+  testResult &= expectError(parser, "CMD-9223372036854775809", InParseError_OUT_OF_RANGE, 3);
+  //too big for uint64
+  testResult &= expectError(parser, "CMD1,18446744073709551616", InParseError_OUT_OF_RANGE, 5);
+  testResult &= expectError(parser, "CMD(99999999999999999999999)", InParseError_OUT_OF_RANGE, 4);
+
+  //floats are not limited by integer range
+  cmd = parser.parse( make_shared<string>("CMD99999999999999999999999.5"));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble() == 99999999999999999999999.5);
+
+  cmd = parser.parse( make_shared<string>("CMD(0.1,-.25)"));
+  testResult &= (cmd != nullptr) && (cmd->sequenceArgument(0, 0).asDouble() == 0.1);
+  testResult &= (cmd != nullptr) && (cmd->sequenceArgument(0, 1).asDouble() == -0.25);
+
+  //out of double range: too big is infinity, too small is 0 with kept sign, subnormals are exact
+  const string tooBig = string(400, '9') + ".5";
+  const string tooSmall = "0." + string(400, '0') + "1";
+  const string subnormal = "0." + string(309, '0') + "1";
+  cmd = parser.parse( make_shared<string>("CMD" + tooBig + ",-" + tooBig));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble(0) == HUGE_VAL) && (cmd->argumentAsDouble(1) == -HUGE_VAL);
+  cmd = parser.parse( make_shared<string>("CMD" + tooSmall + ",-" + tooSmall));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble(0) == 0.0) && (signbit(cmd->argumentAsDouble(0)) == false);
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble(1) == 0.0) && (signbit(cmd->argumentAsDouble(1)) == true);
+  cmd = parser.parse( make_shared<string>("CMD" + subnormal));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble() == 1e-310);
+  //leading zeros of integer part don't make it overflow
+  cmd = parser.parse( make_shared<string>("CMD000" + tooSmall));
+  testResult &= (cmd != nullptr) && (cmd->argumentAsDouble() == 0.0);
+
+  return testResult;
+}
+
+static constexpr CommandId PWD_CMD("PWD");
+static constexpr CommandId SEQ_CMD("SEQ");
+static constexpr CommandSchemaEntry TEST_SCHEMA[] = {
+  {CommandId("CMD"), CommandShape_NONE},
+  {PWD_CMD, CommandShape_STRINGS},
+  {CommandId("SET"), CommandShape_DIGITS},
+  {SEQ_CMD, CommandShape_DIGIT_MULTI_SEQUENCE},
+  {CommandId("TXT"), CommandShape_STRING_MULTI_SEQUENCE},
+};
+static_assert(PWD_CMD.value() == 0x50574400, "Packed like MiniInParser");
+
+static bool testSchema() {
+  bool testResult = true;
+  InParser parser(TEST_SCHEMA);
+  RemoteCommandView view;
+
+  testResult &= parser.parse(string_view("PWD\"pass\""), view).error == InParseError_NONE;
+  testResult &= view == PWD_CMD && view.getCommandId().value() == 0x50574400;
+  testResult &= view.getArgType() == RemoteCommandArgumentType_STRING;
+
+  testResult &= parser.parse(string_view("SET1,-2.5"), view).error == InParseError_NONE;
+  testResult &= view.getArgType() == RemoteCommandArgumentType_DIGIT_SEQUENCE && view.argumentsCount() == 2;
+
+  testResult &= parser.parse(string_view("SEQ(1,2)(3)"), view).error == InParseError_NONE;
+  testResult &= view == SEQ_CMD && view.valuesCount() == 3;
+  testResult &= parser.parse(string_view("TXT(\"a\")"), view).error == InParseError_NONE;
+  testResult &= view.getArgType() == RemoteCommandArgumentType_STRING_MULTI_SEQUENCE;
+
+  testResult &= expectError(parser, "XYZ1", InParseError_UNKNOWN_CMD, 0);
+  testResult &= expectError(parser, "CMD1", InParseError_SCHEMA_MISMATCH, 3);
+  testResult &= expectError(parser, "PWD", InParseError_SCHEMA_MISMATCH, 3);
+  testResult &= expectError(parser, "PWD12", InParseError_SCHEMA_MISMATCH, 3);
+  testResult &= expectError(parser, "SET\"1\"", InParseError_SCHEMA_MISMATCH, 3);
+  testResult &= expectError(parser, "SEQ1", InParseError_SCHEMA_MISMATCH, 3);
+  //shape is fixed, so strings are not accepted in digits sequence
+  testResult &= expectError(parser, "SEQ(\"a\")", InParseError_INVALID_DIGIT_CHAR, 4);
+  testResult &= expectError(parser, "TXT(1)", InParseError_EXPECTED_QUOTE, 4);
+
+  shared_ptr<RemoteCommand> cmd = parser.parse(make_shared<string>("SET7"));
+  testResult &= (cmd != nullptr) && (*cmd == CommandId("SET")) && (cmd->argumentAsInt() == 7);
+
+  //without schema id is still available
+  InParser generic;
+  testResult &= generic.parse(string_view("XYZ"), view).error == InParseError_NONE;
+  testResult &= view == COMMAND_ID("XYZ");
+
+  return testResult;
+}
+
 bool testInParser() {
     bool result = true;
     try {
@@ -337,6 +511,11 @@ bool testInParser() {
       
         result &= testDigitMultiListParamCmd();
         result &= testStringMultiListParamCmd();
+
+        result &= testFlatAccessors();
+        result &= testErrorCodes();
+        result &= testNumberRanges();
+        result &= testSchema();
     } catch (...) {
         return false;
     }
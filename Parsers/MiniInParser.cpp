@@ -6,243 +6,226 @@
  */
 
 #include "MiniInParser.h"
+#include "CharScanner.h"
 #include <stdlib.h>
+#include <string.h>
 
 static const char endLineCharacter = 13;
 
-typedef enum {
-    MiniInParserMode_EXPECT_COMMAND,
-    MiniInParserMode_CMD_PARSED,
-    MiniInParserMode_DIGIT,
-    MiniInParserMode_DIGIT_FIXED,
-    MiniInParserMode_DIGIT_SWALLOW,
-    MiniInParserMode_STRING,
-    MiniInParserMode_NEED_RESET,
-} MiniInParserMode;
-
-typedef enum {
-    ParserHelperState_START_OF_MODE,
-    ParserHelperState_IN_PROGRESS,
-    ParserHelperState_EXPECT_EOL,
-    ParserHelperState_SWALLOW_TO_EOL
-} ParserHelperState;
-
-static MiniInParserMode mode = MiniInParserMode_EXPECT_COMMAND;
-static ParserHelperState parserHelper = ParserHelperState_START_OF_MODE;
-static uint8_t parserIndex;
-static bool negative;
-static uint16_t fracPart;
-
-void parseCmd(char nextChar, Command* outCmd, ParseResult* result) {
-    if (parserHelper == ParserHelperState_START_OF_MODE) {
+static MiniInParserState defaultState = {
+    MiniInParserMode_EXPECT_COMMAND, ParserHelperState_START_OF_MODE, 0, false, 0
+};
+
+void parseCmd(MiniInParserState* state, char nextChar, Command* outCmd, ParseResult* result) {
+    if (state->parserHelper == ParserHelperState_START_OF_MODE) {
         outCmd->cmd = 0;
-        parserHelper = ParserHelperState_IN_PROGRESS;
+        state->parserHelper = ParserHelperState_IN_PROGRESS;
     }
     if (nextChar == endLineCharacter) {
         *result = ParseResult_ERROR_NO_CMD;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
         return;
     }
 
     if (nextChar < 'A' || nextChar > 'Z') {
         *result = ParseResult_ERROR_INVALID_CMD;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
         return;
     }
 
     outCmd->cmd |= (uint8_t)nextChar;
     outCmd->cmd <<= 8;
-    parserIndex++;
+    state->parserIndex++;
 
-    mode = parserIndex == 3 ? MiniInParserMode_CMD_PARSED : MiniInParserMode_EXPECT_COMMAND;
+    state->mode = state->parserIndex == 3 ? MiniInParserMode_CMD_PARSED : MiniInParserMode_EXPECT_COMMAND;
     *result = ParseResult_WILL_CONTINUE;
 }
 
-void finalizeParseWithSuccess(ParseResult* result) {
+void finalizeParseWithSuccess(MiniInParserState* state, ParseResult* result) {
     *result = ParseResult_SUCCESS;
-    miniInParserReset();
+    miniInParserReset(state);
 }
 
-void handleStringArgument(char nextChar, Command* outCmd, ParseResult* result) {
+void handleStringArgument(MiniInParserState* state, char nextChar, Command* outCmd, ParseResult* result) {
 
     if (nextChar == endLineCharacter) {
-        if (parserHelper != ParserHelperState_EXPECT_EOL) {
+        if (state->parserHelper != ParserHelperState_EXPECT_EOL) {
             *result = ParseResult_ERROR_MALFORMED;
-            mode = MiniInParserMode_NEED_RESET;
+            state->mode = MiniInParserMode_NEED_RESET;
             return;
 
         } else {
             //end of string
-            finalizeParseWithSuccess(result);
+            finalizeParseWithSuccess(state, result);
             return;
         }
     }
 
-    if (parserIndex == outCmd->stringValueMaxLen) {
+    if (state->parserIndex == outCmd->stringValueMaxLen) {
         if (nextChar == '"') {
-            outCmd->stringValue[parserIndex] = 0;
-            parserHelper = ParserHelperState_EXPECT_EOL;
+            outCmd->stringValue[state->parserIndex] = 0;
+            state->parserHelper = ParserHelperState_EXPECT_EOL;
             *result = ParseResult_WILL_CONTINUE;
-            mode = MiniInParserMode_STRING;
+            state->mode = MiniInParserMode_STRING;
 
         } else {
             outCmd->stringValue[outCmd->stringValueMaxLen - 1] = 0;
             *result = ParseResult_ERROR_STRING_OVERFLOW;
-            mode = MiniInParserMode_NEED_RESET;
+            state->mode = MiniInParserMode_NEED_RESET;
         }
         return;
     }
 
     if (nextChar == '"') {
-      if (parserHelper == ParserHelperState_EXPECT_EOL) {
+      if (state->parserHelper == ParserHelperState_EXPECT_EOL) {
           *result = ParseResult_ERROR_MALFORMED;
-          mode = MiniInParserMode_NEED_RESET;
+          state->mode = MiniInParserMode_NEED_RESET;
         
       } else {
-          outCmd->stringValue[parserIndex] = 0;
-          parserHelper = ParserHelperState_EXPECT_EOL;
+          outCmd->stringValue[state->parserIndex] = 0;
+          state->parserHelper = ParserHelperState_EXPECT_EOL;
           *result = ParseResult_WILL_CONTINUE;
-          mode = MiniInParserMode_STRING;
+          state->mode = MiniInParserMode_STRING;
       }
       return;
     }
   
     if (nextChar <' ' || nextChar > '~') {
         *result = ParseResult_ERROR_MALFORMED;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
         return;
     }
 
-    outCmd->stringValue[parserIndex] = nextChar;
-    parserIndex++;
+    outCmd->stringValue[state->parserIndex] = nextChar;
+    state->parserIndex++;
     *result = ParseResult_WILL_CONTINUE;
-    mode = MiniInParserMode_STRING;
+    state->mode = MiniInParserMode_STRING;
 }
 
-void handleDigitArgument(char nextChar, Command* outCmd, ParseResult* result) {
-    if (parserHelper == ParserHelperState_START_OF_MODE) {
+void handleDigitArgument(MiniInParserState* state, char nextChar, Command* outCmd, ParseResult* result) {
+    if (state->parserHelper == ParserHelperState_START_OF_MODE) {
         outCmd->numericValue = 0;
-        negative = nextChar == '-';
-        parserHelper = ParserHelperState_IN_PROGRESS;
-        if (negative == true) {
+        state->negative = nextChar == '-';
+        state->parserHelper = ParserHelperState_IN_PROGRESS;
+        if (state->negative == true) {
             *result = ParseResult_WILL_CONTINUE;
-            mode = MiniInParserMode_DIGIT;
+            state->mode = MiniInParserMode_DIGIT;
             return;
         }
     }
     if (nextChar == endLineCharacter) {
-        if (negative) {
+        if (state->negative) {
             outCmd->numericValue = -outCmd->numericValue;
         }
-        finalizeParseWithSuccess(result);
+        finalizeParseWithSuccess(state, result);
         return;
     }
     if (nextChar == '.') {
         *result = ParseResult_WILL_CONTINUE;
-        mode = MiniInParserMode_DIGIT_FIXED;
-        parserIndex = 0;
-        fracPart = 0;
+        state->mode = MiniInParserMode_DIGIT_FIXED;
+        state->parserIndex = 0;
+        state->fracPart = 0;
         outCmd->outParamType = OutParamType_FIXED_DIGIT;
         return;
     }
     if (nextChar < '0' || nextChar > '9') {
         *result = ParseResult_ERROR_MALFORMED;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
         return;
     }
     outCmd->numericValue *= 10;
     outCmd->numericValue += nextChar - '0';
     *result = ParseResult_WILL_CONTINUE;
-    mode = MiniInParserMode_DIGIT;
+    state->mode = MiniInParserMode_DIGIT;
 }
 
-void finalizeFixedDigit(Command* outCmd, ParseResult* result) {
+void finalizeFixedDigit(MiniInParserState* state, Command* outCmd, ParseResult* result) {
     //in outCmd->numericValue is integral part, it need to be truncated to 23b (1 bit for sign)
     if (outCmd->numericValue > 0x7FFFFF) {
         outCmd->numericValue = 0x7FFFFF;
     }
     outCmd->numericValue <<= 8; //make place for fract part
     uint16_t base = 1;
-    for(;parserIndex != 0; parserIndex --) {
+    for(;state->parserIndex != 0; state->parserIndex --) {
         base *= 10;
     }
-    uint16_t scalled = (fracPart << 8) / base;
+    uint16_t scalled = (state->fracPart << 8) / base;
     outCmd->numericValue |= scalled & 0xFF;
-    if (negative) {
+    if (state->negative) {
         outCmd->numericValue = (~outCmd->numericValue) & 0xFFFFFFFF;
     }
-    finalizeParseWithSuccess(result);
+    finalizeParseWithSuccess(state, result);
 }
 
-void handleFracDigitArgument(char nextChar, Command* outCmd, ParseResult* result) {
+void handleFracDigitArgument(MiniInParserState* state, char nextChar, Command* outCmd, ParseResult* result) {
     if (nextChar == endLineCharacter) {
-        finalizeFixedDigit(outCmd, result);
+        finalizeFixedDigit(state, outCmd, result);
         return;
     }
 
     if (nextChar < '0' || nextChar > '9') {
         *result = ParseResult_ERROR_MALFORMED;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
         return;
     }
-    if (parserHelper == ParserHelperState_IN_PROGRESS) {
-        fracPart *= 10;
-        fracPart += nextChar - '0';
-        parserIndex++;
-        parserHelper = parserIndex < 3 ? ParserHelperState_IN_PROGRESS : ParserHelperState_SWALLOW_TO_EOL;
+    if (state->parserHelper == ParserHelperState_IN_PROGRESS) {
+        state->fracPart *= 10;
+        state->fracPart += nextChar - '0';
+        state->parserIndex++;
+        state->parserHelper = state->parserIndex < 3 ? ParserHelperState_IN_PROGRESS : ParserHelperState_SWALLOW_TO_EOL;
     }
     *result = ParseResult_WILL_CONTINUE;
-    mode = MiniInParserMode_DIGIT_FIXED;
+    state->mode = MiniInParserMode_DIGIT_FIXED;
 }
 
-void discoverParam(char nextChar, Command* outCmd, ParseResult* result) {
+void discoverParam(MiniInParserState* state, char nextChar, Command* outCmd, ParseResult* result) {
     if (nextChar == '"') {
         *result = ParseResult_WILL_CONTINUE;
-        mode = MiniInParserMode_STRING;
+        state->mode = MiniInParserMode_STRING;
         outCmd->outParamType = OutParamType_STRING;
-        parserHelper = ParserHelperState_START_OF_MODE;
-        parserIndex = 0;
+        state->parserHelper = ParserHelperState_START_OF_MODE;
+        state->parserIndex = 0;
 
     } else if (nextChar == '-' || (nextChar >= '0' && nextChar <= '9')) {
         *result = ParseResult_WILL_CONTINUE;
-        mode = MiniInParserMode_DIGIT;
+        state->mode = MiniInParserMode_DIGIT;
         outCmd->outParamType = OutParamType_INT_DIGIT;
-        parserHelper = ParserHelperState_START_OF_MODE;
-        parserIndex = 0;
-        handleDigitArgument(nextChar, outCmd, result);
+        state->parserHelper = ParserHelperState_START_OF_MODE;
+        state->parserIndex = 0;
+        handleDigitArgument(state, nextChar, outCmd, result);
 
     } else if (nextChar == endLineCharacter) {
-        finalizeParseWithSuccess(result);
+        finalizeParseWithSuccess(state, result);
         outCmd->outParamType = OutParamType_NONE;
 
     } else {
         *result = ParseResult_ERROR_MALFORMED;
-        mode = MiniInParserMode_NEED_RESET;
+        state->mode = MiniInParserMode_NEED_RESET;
     }
 }
 
-ParseResult miniInParse(char nextChar, Command* outCmd) {
+ParseResult miniInParse(MiniInParserState* state, char nextChar, Command* outCmd) {
     ParseResult result = ParseResult_ERROR_MALFORMED;
-    switch(mode) {
+    switch(state->mode) {
         default:
         case MiniInParserMode_EXPECT_COMMAND:
-            parseCmd(nextChar, outCmd, &result);
+            parseCmd(state, nextChar, outCmd, &result);
             break;
 
         case MiniInParserMode_CMD_PARSED:
-            discoverParam(nextChar, outCmd, &result);
+            discoverParam(state, nextChar, outCmd, &result);
             break;
 
         case MiniInParserMode_STRING:
-            handleStringArgument(nextChar, outCmd, &result);
+            handleStringArgument(state, nextChar, outCmd, &result);
             break;
 
         case MiniInParserMode_DIGIT:
-            handleDigitArgument(nextChar, outCmd, &result);
+            handleDigitArgument(state, nextChar, outCmd, &result);
             break;
 
         case MiniInParserMode_DIGIT_FIXED:
-            handleFracDigitArgument(nextChar, outCmd, &result);
+            handleFracDigitArgument(state, nextChar, outCmd, &result);
             break;
         
         case MiniInParserMode_NEED_RESET:
@@ -253,10 +236,104 @@ ParseResult miniInParse(char nextChar, Command* outCmd) {
     return result;
 }
 
+//Fast path for characters which only extend current argument, returns number of consumed bytes
+static size_t consumeArgumentRun(MiniInParserState* state, const char* data, size_t length, Command* outCmd) {
+    size_t t = 0;
+    switch (state->mode) {
+        case MiniInParserMode_EXPECT_COMMAND:
+            //whole id at once, for commands without argument it's most of the frame
+            if (state->parserHelper == ParserHelperState_START_OF_MODE && length >= 3 &&
+                data[0] >= 'A' && data[0] <= 'Z' && data[1] >= 'A' && data[1] <= 'Z' &&
+                data[2] >= 'A' && data[2] <= 'Z') {
+                outCmd->cmd = (((uint32_t)(uint8_t)data[0] << 16) | ((uint32_t)(uint8_t)data[1] << 8) |
+                    (uint8_t)data[2]) << 8;
+                state->parserIndex = 3;
+                state->parserHelper = ParserHelperState_IN_PROGRESS;
+                state->mode = MiniInParserMode_CMD_PARSED;
+                t = 3;
+            }
+            break;
+
+        case MiniInParserMode_STRING:
+            if (state->parserHelper != ParserHelperState_EXPECT_EOL) {
+                const size_t space = outCmd->stringValueMaxLen - state->parserIndex;
+                t = scanStringRun(data, length < space ? length : space);
+                memcpy(outCmd->stringValue + state->parserIndex, data, t);
+                state->parserIndex += t;
+            }
+            break;
+
+        case MiniInParserMode_DIGIT: {
+            uint64_t value = outCmd->numericValue;
+            for (; t < length && data[t] >= '0' && data[t] <= '9'; t++) {
+                value = value * 10 + (data[t] - '0');
+            }
+            outCmd->numericValue = value;
+            break;
+        }
+
+        case MiniInParserMode_DIGIT_FIXED:
+            if (state->parserHelper == ParserHelperState_SWALLOW_TO_EOL) {
+                while (t < length && data[t] >= '0' && data[t] <= '9') {
+                    t++;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+    return t;
+}
+
+size_t miniInParseBuffer(MiniInParserState* state, const char* data, size_t length, Command* outCmd,
+                         ParseResult* outResult) {
+    ParseResult result = ParseResult_WILL_CONTINUE;
+    size_t t = 0;
+    while (t < length) {
+        t += consumeArgumentRun(state, data + t, length - t, outCmd);
+        if (t == length) {
+            break;
+        }
+        result = miniInParse(state, data[t], outCmd);
+        t++;
+        if (result != ParseResult_WILL_CONTINUE) {
+            break;
+        }
+    }
+    if (outResult != nullptr) {
+        *outResult = result;
+    }
+    return t;
+}
+
+bool miniInParse(MiniInParserState* state, ParserDataFeeder feederFunction, Command* outCmd) {
+    char nextChar;
+    while (feederFunction(&nextChar) == true) {
+        ParseResult result = miniInParse(state, nextChar, outCmd);
+        if (result != ParseResult_WILL_CONTINUE) {
+            return result == ParseResult_SUCCESS;
+        }
+    }
+    return false;
+}
+
+void miniInParserReset(MiniInParserState* state) {
+    state->mode = MiniInParserMode_EXPECT_COMMAND;
+    state->parserIndex = 0;
+    state->negative = false;
+    state->fracPart = 0;
+    state->parserHelper = ParserHelperState_START_OF_MODE;
+}
+
+bool miniInParse(ParserDataFeeder feederFunction, Command* outCmd) {
+    return miniInParse(&defaultState, feederFunction, outCmd);
+}
+
+ParseResult miniInParse(char nextChar, Command* outCmd) {
+    return miniInParse(&defaultState, nextChar, outCmd);
+}
+
 void miniInParserReset() {
-    mode = MiniInParserMode_EXPECT_COMMAND;
-    parserIndex = 0;
-    negative = false;
-    fracPart = 0;
-    parserHelper = ParserHelperState_START_OF_MODE;
+    miniInParserReset(&defaultState);
 }
@@ -9,6 +9,7 @@
 #define MiniInParser_hpp
 
 #include <stdint.h>
+#include <stddef.h>
 
 typedef bool(*ParserDataFeeder)(char*);
 
@@ -38,8 +39,46 @@ typedef enum {
     ParseResult_SUCCESS,     //Successfully parsed, logic can interpret result
 } ParseResult;
 
-bool miniInParse(ParserDataFeeder feederFunction, Command* outCmd);
+typedef enum {
+    MiniInParserMode_EXPECT_COMMAND,
+    MiniInParserMode_CMD_PARSED,
+    MiniInParserMode_DIGIT,
+    MiniInParserMode_DIGIT_FIXED,
+    MiniInParserMode_DIGIT_SWALLOW,
+    MiniInParserMode_STRING,
+    MiniInParserMode_NEED_RESET,
+} MiniInParserMode;
+
+typedef enum {
+    ParserHelperState_START_OF_MODE,
+    ParserHelperState_IN_PROGRESS,
+    ParserHelperState_EXPECT_EOL,
+    ParserHelperState_SWALLOW_TO_EOL
+} ParserHelperState;
+
+//State of single byte stream, independent streams can be parsed concurrently with own states.
+//Call miniInParserReset(state) before first use.
+typedef struct {
+    MiniInParserMode    mode;
+    ParserHelperState   parserHelper;
+    uint8_t             parserIndex;
+    bool                negative;
+    uint16_t            fracPart;
+} MiniInParserState;
+
+//Pulls characters from feederFunction until command is completed, false on error or if feeder has no more data
+bool miniInParse(MiniInParserState* state, ParserDataFeeder feederFunction, Command* outCmd);
+
+ParseResult miniInParse(MiniInParserState* state, char nextChar, Command* outCmd);
+void miniInParserReset(MiniInParserState* state);
 
+//Consumes bytes until end of buffer, completed command or error. Returns number of consumed bytes,
+//outResult is ParseResult_WILL_CONTINUE if whole buffer was used without completing command.
+size_t miniInParseBuffer(MiniInParserState* state, const char* data, size_t length, Command* outCmd,
+                         ParseResult* outResult);
+
+//Those are working on default, global state
+bool miniInParse(ParserDataFeeder feederFunction, Command* outCmd);
 ParseResult miniInParse(char nextChar, Command* outCmd);
 void miniInParserReset();
 
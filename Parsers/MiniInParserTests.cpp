@@ -7,6 +7,7 @@
 
 #include "MiniInParserTests.h"
 #include "MiniInParser.h"
+#include "CommandId.hpp"
 #include <stdio.h>
 #include <string.h>
 
@@ -205,6 +206,172 @@ static bool testIntFixedParamCmd() {
     return testResult;
 }
 
+static bool testInterleavedStreams() {
+    //bytes of three streams are fed alternately, each one with own state
+    const char* streams[3] = {"CMD\"first\"\r", "ABC-1234\r", "XYZ12.5\r"};
+    MiniInParserState states[3];
+    Command cmds[3];
+    char strBuf[3][20];
+    ParseResult results[3];
+    size_t positions[3] = {0, 0, 0};
+    bool testResult = true;
+
+    for (int t = 0; t < 3; t++) {
+        miniInParserReset(&states[t]);
+        cmds[t].stringValue = strBuf[t];
+        cmds[t].stringValueMaxLen = sizeof(strBuf[t]);
+        results[t] = ParseResult_WILL_CONTINUE;
+    }
+
+    bool anyInProgress = true;
+    while (anyInProgress == true) {
+        anyInProgress = false;
+        for (int t = 0; t < 3; t++) {
+            if (results[t] != ParseResult_WILL_CONTINUE || positions[t] >= strlen(streams[t])) {
+                continue;
+            }
+            results[t] = miniInParse(&states[t], streams[t][positions[t]], &cmds[t]);
+            positions[t]++;
+            anyInProgress = true;
+        }
+    }
+
+    testResult &= results[0] == ParseResult_SUCCESS;
+    testResult &= cmds[0].cmd == 0x434d4400;
+    testResult &= cmds[0].outParamType == OutParamType_STRING;
+    testResult &= strcmp("first", cmds[0].stringValue) == 0;
+
+    testResult &= results[1] == ParseResult_SUCCESS;
+    testResult &= cmds[1].cmd == 0x41424300;
+    testResult &= cmds[1].outParamType == OutParamType_INT_DIGIT;
+    testResult &= ((int64_t)cmds[1].numericValue) == -1234;
+
+    testResult &= results[2] == ParseResult_SUCCESS;
+    testResult &= cmds[2].cmd == 0x58595a00;
+    testResult &= cmds[2].outParamType == OutParamType_FIXED_DIGIT;
+    testResult &= cmds[2].numericValue == ((12 << 8) | (5 * 256 / 10));
+
+    //error in one stream doesn't affect other one
+    miniInParserReset(&states[0]);
+    miniInParserReset(&states[1]);
+    testResult &= miniInParse(&states[0], 'c', &cmds[0]) == ParseResult_ERROR_INVALID_CMD;
+    testResult &= miniInParse(&states[1], 'R', &cmds[1]) == ParseResult_WILL_CONTINUE;
+    testResult &= miniInParse(&states[0], 'C', &cmds[0]) == ParseResult_ERROR_NEED_RESET_PARSER;
+    testResult &= miniInParse(&states[1], 'T', &cmds[1]) == ParseResult_WILL_CONTINUE;
+    testResult &= miniInParse(&states[1], 'H', &cmds[1]) == ParseResult_WILL_CONTINUE;
+    testResult &= miniInParse(&states[1], '\r', &cmds[1]) == ParseResult_SUCCESS;
+    testResult &= cmds[1].outParamType == OutParamType_NONE;
+
+    return testResult;
+}
+
+static bool testBufferFeed() {
+    const char* data = "CMD\"some text\"\rABC-1234\rXYZ12.56789\rQQ\r";
+    const size_t length = strlen(data);
+    MiniInParserState state;
+    Command cmd;
+    char strBuf[20];
+    cmd.stringValue = strBuf;
+    cmd.stringValueMaxLen = sizeof(strBuf);
+    ParseResult result;
+    bool testResult = true;
+    miniInParserReset(&state);
+
+    //parser stops after each command
+    size_t used = miniInParseBuffer(&state, data, length, &cmd, &result);
+    testResult &= result == ParseResult_SUCCESS;
+    testResult &= used == 15;
+    testResult &= strcmp("some text", cmd.stringValue) == 0;
+
+    used += miniInParseBuffer(&state, data + used, length - used, &cmd, &result);
+    testResult &= result == ParseResult_SUCCESS;
+    testResult &= used == 24;
+    testResult &= ((int64_t)cmd.numericValue) == -1234;
+
+    //data split in the middle of argument
+    size_t part = miniInParseBuffer(&state, data + used, 5, &cmd, &result);
+    testResult &= result == ParseResult_WILL_CONTINUE;
+    testResult &= part == 5;
+    used += part;
+    used += miniInParseBuffer(&state, data + used, length - used, &cmd, &result);
+    testResult &= result == ParseResult_SUCCESS;
+    testResult &= cmd.outParamType == OutParamType_FIXED_DIGIT;
+    testResult &= cmd.numericValue == ((12 << 8) | (567 * 256 / 1000));
+
+    //error is reported on byte which caused it
+    part = miniInParseBuffer(&state, data + used, length - used, &cmd, &result);
+    testResult &= result == ParseResult_ERROR_NO_CMD;
+    testResult &= used + part == length;
+
+    //overflow inside of fast string path
+    miniInParserReset(&state);
+    cmd.stringValueMaxLen = 4;
+    miniInParseBuffer(&state, "CMD\"0123456\"\r", 13, &cmd, &result);
+    testResult &= result == ParseResult_ERROR_STRING_OVERFLOW;
+    testResult &= strBuf[3] == 0;
+
+    //command id taken at once is packed the same way as byte by byte
+    Command single;
+    miniInParserReset(&state);
+    miniInParseBuffer(&state, "PNG\r", 4, &cmd, &result);
+    testResult &= result == ParseResult_SUCCESS && cmd.outParamType == OutParamType_NONE;
+    miniInParserReset(&state);
+    for (const char* c = "PNG\r"; *c != 0; c++) {
+        miniInParse(&state, *c, &single);
+    }
+    testResult &= cmd.cmd == single.cmd;
+
+    //invalid id is still reported on its byte
+    miniInParserReset(&state);
+    used = miniInParseBuffer(&state, "PnG\r", 4, &cmd, &result);
+    testResult &= result == ParseResult_ERROR_INVALID_CMD && used == 2;
+
+    return testResult;
+}
+
+static const char* feederData;
+
+static bool testFeeder(char* outChar) {
+    if (*feederData == 0) {
+        return false;
+    }
+    *outChar = *feederData++;
+    return true;
+}
+
+static bool testFeederParse() {
+    Command cmd;
+    bool testResult;
+    miniInParserReset();
+
+    feederData = "CMD42\rCMD";
+    testResult = miniInParse(testFeeder, &cmd) == true;
+    testResult &= cmd.numericValue == 42;
+
+    //not enough data
+    testResult &= miniInParse(testFeeder, &cmd) == false;
+    return testResult;
+}
+
+static bool testCommandId() {
+    Command cmd;
+    bool testResult;
+    miniInParserReset();
+
+    ParseResult result = executeParse("PWD12\r", &cmd);
+    testResult = result == ParseResult_SUCCESS;
+    testResult &= cmd.cmd == CommandId("PWD").value();
+    testResult &= CommandId::fromPacked(cmd.cmd).charAt(1) == 'W';
+
+    //raw values are validated, anything else than 3 capital letters is "no command"
+    testResult &= CommandId::fromPacked(0x50574400) == CommandId("PWD");
+    testResult &= CommandId::fromPacked(0).isValid() == false;
+    testResult &= CommandId::fromPacked(0x50774400).isValid() == false;   //"PwD"
+    testResult &= CommandId::fromPacked(0x50574401).isValid() == false;
+    testResult &= CommandId().isValid() == false;
+    return testResult;
+}
+
 bool testMiniInParser() {
     bool result = true;
   
@@ -212,6 +379,10 @@ bool testMiniInParser() {
     result &= testIntDigitParamCmd();
     result &= testIntFixedParamCmd();
     result &= testStringParamCmd();
+    result &= testInterleavedStreams();
+    result &= testBufferFeed();
+    result &= testFeederParse();
+    result &= testCommandId();
 
     return result;
 }
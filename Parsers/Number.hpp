@@ -4,19 +4,28 @@
 #include <stdint.h>
 
 //taken from http://stackoverflow.com/a/8058976/2444937 and modified
+//SignedIntType holds negative values only, non negative ones are IntType whatever integer type
+//they were built from, so they keep full uint64 range and the same type as unsigned literals
 class Number {
     private:
         enum ValType {
-            DoubleType, IntType
+            DoubleType, IntType, SignedIntType
         } curType;
         union {
                 double doubleVal;
                 uint64_t intVal;
+                int64_t signedIntVal;
         };
     public:
         Number(uint64_t n) :
             curType(IntType), intVal(n) {
         }
+        Number(int64_t n) :
+            curType(n < 0 ? SignedIntType : IntType), signedIntVal(n) {
+        }
+        Number(int n) :
+            curType(n < 0 ? SignedIntType : IntType), signedIntVal(n) {
+        }
         Number(float n) :
             curType(DoubleType), doubleVal(n) {
         }
@@ -31,24 +40,40 @@ class Number {
             }
         }
 
-        int64_t asInt64() {
+        bool isDouble() const {
+            return curType == DoubleType;
+        }
+
+        bool isSigned() const {
+            return curType == SignedIntType;
+        }
+
+        int64_t asInt64() const {
             return curType == DoubleType ? static_cast<int64_t>(doubleVal) : static_cast<int64_t>(intVal);
         }
   
-        uint64_t asUInt64() {
+        //negative values are wrapped
+        uint64_t asUInt64() const {
           return curType == DoubleType ? static_cast<uint64_t>(doubleVal) : intVal;
         }
   
-        int asInt() {
+        int asInt() const {
             return curType == DoubleType ? static_cast<int>(doubleVal) : static_cast<int>(intVal);
         }
 
-        double asDouble() {
-            return curType == DoubleType ? doubleVal : static_cast<double>(intVal);
+        double asDouble() const {
+            switch (curType) {
+                case DoubleType:
+                    return doubleVal;
+                case SignedIntType:
+                    return static_cast<double>(signedIntVal);
+                default:
+                    return static_cast<double>(intVal);
+            }
         }
 
-        double asFloat() {
-            return curType == DoubleType ? static_cast<float>(doubleVal) : static_cast<float>(intVal);
+        double asFloat() const {
+            return static_cast<float>(asDouble());
         }
 };
 
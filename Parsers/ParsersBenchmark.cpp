@@ -0,0 +1,384 @@
+/*
+ * ParsersBenchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#include "ParsersBenchmark.hpp"
+#include "InParser.h"
+#include "MiniInParser.h"
+#include "RemoteCommandBuilder.h"
+#include "CharScanner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <chrono>
+
+using namespace std::chrono;
+
+//every allocation of benchmark executable is counted
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* result = malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw bad_alloc();
+    }
+    return result;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+static const size_t FRAMES_PER_CORPUS = 4096;
+static const uint32_t CORPUS_SEED = 0x2017;
+//each measurement processes at least that many bytes
+static const size_t TARGET_BYTES = 32 * 1024 * 1024;
+static const size_t MAX_FRAME_SIZE = 1024;
+
+static volatile size_t sink;
+
+//xorshift32, corpora have to be identical between runs and platforms
+static uint32_t nextRandom(uint32_t& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static const char* const SENSOR_NAMES[] = {
+    "kitchen", "garage", "living room", "outdoor north", "bedroom 2", "boiler"
+};
+static const size_t SENSOR_NAMES_COUNT = sizeof(SENSOR_NAMES) / sizeof(SENSOR_NAMES[0]);
+
+//Without buffer builder works on own string, so the same generator is used to create corpus
+//and to measure both modes of RemoteCommandBuilder
+typedef RemoteCommandBuilder (*FrameGenerator)(uint32_t& seed, char* buffer, size_t bufferSize);
+
+static RemoteCommandBuilder generateNoArgument(uint32_t& seed, char* buffer, size_t bufferSize) {
+    static const CommandId commands[] = {CommandId("PNG"), CommandId("RST"), CommandId("GET"), CommandId("ACK")};
+    return RemoteCommandBuilder(commands[nextRandom(seed) % 4], buffer, bufferSize);
+}
+
+//what devices are sending most of the time, single value per frame
+static RemoteCommandBuilder generateSensorReading(uint32_t& seed, char* buffer, size_t bufferSize) {
+    const uint32_t value = nextRandom(seed);
+    switch (value % 4) {
+        case 0: {
+            RemoteCommandBuilder builder(COMMAND_ID("TMP"), buffer, bufferSize);
+            builder.addArgument(static_cast<int>((value >> 8) % 6000) / 100.0 - 20.0);
+            return builder;
+        }
+        case 1: {
+            RemoteCommandBuilder builder(COMMAND_ID("HUM"), buffer, bufferSize);
+            builder.addArgument(static_cast<int>((value >> 8) % 101));
+            return builder;
+        }
+        case 2: {
+            RemoteCommandBuilder builder(COMMAND_ID("BAT"), buffer, bufferSize);
+            builder.addArgument(static_cast<int>(2000 + (value >> 8) % 2200));
+            return builder;
+        }
+        default: {
+            RemoteCommandBuilder builder(COMMAND_ID("NAM"), buffer, bufferSize);
+            builder.addArgument(SENSOR_NAMES[(value >> 8) % SENSOR_NAMES_COUNT]);
+            return builder;
+        }
+    }
+}
+
+static RemoteCommandBuilder generateDigitSequence(uint32_t& seed, char* buffer, size_t bufferSize) {
+    RemoteCommandBuilder builder(COMMAND_ID("SET"), buffer, bufferSize);
+    for (int t = 0; t < 32; t++) {
+        const uint32_t value = nextRandom(seed);
+        if ((value & 3) == 0) {
+            builder.addArgument(static_cast<int>((value >> 8) % 200000) / 1000.0 - 100.0);
+        } else {
+            builder.addArgument(static_cast<int64_t>(value >> 4) - (1 << 27));
+        }
+    }
+    return builder;
+}
+
+static RemoteCommandBuilder generateStringMultiSequence(uint32_t& seed, char* buffer, size_t bufferSize) {
+    RemoteCommandBuilder builder(COMMAND_ID("TXT"), buffer, bufferSize);
+    for (int sequence = 0; sequence < 4; sequence++) {
+        builder.startSequence();
+        for (int t = 0; t < 3; t++) {
+            builder.addArgument(SENSOR_NAMES[nextRandom(seed) % SENSOR_NAMES_COUNT]);
+        }
+        builder.endSequence();
+    }
+    return builder;
+}
+
+typedef struct {
+    const char*     name;
+    FrameGenerator  generator;  //nullptr for malformed frames, they can't be built by RemoteCommandBuilder
+    bool            miniCompatible; //MiniInParser grammar has only single arguments
+} CorpusDefinition;
+
+static const CorpusDefinition CORPORA[] = {
+    {"no-arg", generateNoArgument, true},
+    {"sensor-readings", generateSensorReading, true},
+    {"digit-sequence", generateDigitSequence, false},
+    {"string-multi-sequence", generateStringMultiSequence, false},
+    {"malformed", nullptr, false},
+    //damaged frames of MiniInParser grammar only, so Mini parsers are measured on what they can parse
+    {"malformed-mini", nullptr, true},
+};
+
+typedef struct {
+    const CorpusDefinition*     definition;
+    string                      stream;         //frames ended with '\r', as received from device
+    vector<string_view>         frames;         //points into stream, without '\r'
+    vector<shared_ptr<string> > sharedFrames;
+} Corpus;
+
+//Valid frames damaged in one place: replaced byte, truncation or additional ','
+static void corruptFrame(string& frame, uint32_t& seed) {
+    static const char replacements[] = "x\"(),.-a~\x7f";
+    const size_t position = nextRandom(seed) % frame.size();
+    switch (nextRandom(seed) % 3) {
+        case 0:
+            frame[position] = replacements[nextRandom(seed) % (sizeof(replacements) - 1)];
+            break;
+        case 1:
+            frame.resize(position);
+            break;
+        default:
+            frame.insert(position, 1, ',');
+            break;
+    }
+}
+
+static void generateCorpus(const CorpusDefinition* definition, Corpus& outCorpus) {
+    uint32_t seed = CORPUS_SEED;
+    outCorpus.definition = definition;
+    for (size_t t = 0; t < FRAMES_PER_CORPUS; t++) {
+        if (definition->generator != nullptr) {
+            outCorpus.stream += definition->generator(seed, nullptr, 0).buildCommand();
+        } else {
+            //ending '\r' is never damaged
+            FrameGenerator source = (definition->miniCompatible == true || (t & 1)) ? generateSensorReading :
+                generateDigitSequence;
+            string frame = source(seed, nullptr, 0).buildCommand();
+            frame.pop_back();
+            corruptFrame(frame, seed);
+            outCorpus.stream += frame;
+            outCorpus.stream += '\r';
+        }
+    }
+
+    const char* data = outCorpus.stream.data();
+    size_t left = outCorpus.stream.size();
+    while (left > 0) {
+        const size_t length = scanEndOfLine(data, left);
+        outCorpus.frames.push_back(string_view(data, length));
+        outCorpus.sharedFrames.push_back(make_shared<string>(data, length));
+        data += length + 1;
+        left -= length + 1;
+    }
+}
+
+typedef struct {
+    const char* parser;
+    const char* corpus;
+    size_t      commands;
+    size_t      bytes;
+    double      seconds;
+    double      allocationsPerCommand;
+    size_t      errorsPerPass;  //failed commands, sanity check that corpus is parsed as expected
+} BenchmarkResult;
+
+//pass processes whole corpus once and returns number of failed commands
+template<typename Pass>
+static BenchmarkResult measure(const char* parser, const Corpus& corpus, Pass pass) {
+    const size_t passes = TARGET_BYTES / corpus.stream.size() + 1;
+    BenchmarkResult result;
+    result.parser = parser;
+    result.corpus = corpus.definition->name;
+    result.commands = passes * corpus.frames.size();
+    result.bytes = passes * corpus.stream.size();
+    result.errorsPerPass = pass();     //warm up
+
+    const size_t allocationsBefore = allocations;
+    steady_clock::time_point start = steady_clock::now();
+    for (size_t t = 0; t < passes; t++) {
+        sink = pass();
+    }
+    result.seconds = duration<double>(steady_clock::now() - start).count();
+    result.allocationsPerCommand = static_cast<double>(allocations - allocationsBefore) / result.commands;
+    return result;
+}
+
+static size_t passInParserView(const Corpus& corpus) {
+    InParser parser;
+    RemoteCommandView view;
+    size_t errors = 0;
+    for (const string_view& frame : corpus.frames) {
+        errors += parser.parse(frame, view).error != InParseError_NONE;
+    }
+    return errors;
+}
+
+static size_t passInParserShared(const Corpus& corpus) {
+    InParser parser;
+    size_t errors = 0;
+    for (const shared_ptr<string>& frame : corpus.sharedFrames) {
+        errors += parser.parse(frame) == nullptr;
+    }
+    return errors;
+}
+
+static size_t passMiniInParseBuffer(const Corpus& corpus) {
+    MiniInParserState state;
+    Command cmd;
+    char stringValue[64];
+    cmd.stringValue = stringValue;
+    cmd.stringValueMaxLen = sizeof(stringValue);
+    miniInParserReset(&state);
+
+    size_t errors = 0;
+    const char* data = corpus.stream.data();
+    size_t left = corpus.stream.size();
+    while (left > 0) {
+        ParseResult result;
+        const size_t used = miniInParseBuffer(&state, data, left, &cmd, &result);
+        data += used;
+        left -= used;
+        if (result == ParseResult_SUCCESS || result == ParseResult_WILL_CONTINUE) {
+            continue;
+        }
+        //drop rest of broken frame, unless error was reported on its end
+        errors++;
+        miniInParserReset(&state);
+        if (used == 0 || data[-1] != 13) {
+            const size_t skip = scanEndOfLine(data, left);
+            data += skip < left ? skip + 1 : skip;
+            left -= skip < left ? skip + 1 : skip;
+        }
+    }
+    return errors;
+}
+
+static size_t passMiniInParseChar(const Corpus& corpus) {
+    MiniInParserState state;
+    Command cmd;
+    char stringValue[64];
+    cmd.stringValue = stringValue;
+    cmd.stringValueMaxLen = sizeof(stringValue);
+    miniInParserReset(&state);
+
+    size_t errors = 0;
+    bool skipFrame = false;
+    for (const char c : corpus.stream) {
+        if (skipFrame == true) {
+            skipFrame = c != 13;
+            continue;
+        }
+        const ParseResult result = miniInParse(&state, c, &cmd);
+        if (result != ParseResult_SUCCESS && result != ParseResult_WILL_CONTINUE) {
+            errors++;
+            miniInParserReset(&state);
+            skipFrame = c != 13;
+        }
+    }
+    return errors;
+}
+
+static size_t passBuilderString(const Corpus& corpus) {
+    uint32_t seed = CORPUS_SEED;
+    size_t total = 0;
+    for (size_t t = 0; t < corpus.frames.size(); t++) {
+        total += corpus.definition->generator(seed, nullptr, 0).buildCommand().size();
+    }
+    return total == corpus.stream.size() ? 0 : 1;
+}
+
+static size_t passBuilderBuffer(const Corpus& corpus) {
+    char buffer[MAX_FRAME_SIZE];
+    uint32_t seed = CORPUS_SEED;
+    size_t total = 0;
+    for (size_t t = 0; t < corpus.frames.size(); t++) {
+        total += corpus.definition->generator(seed, buffer, sizeof(buffer)).buildFrame().size();
+    }
+    return total == corpus.stream.size() ? 0 : 1;
+}
+
+static void printText(const vector<BenchmarkResult>& results) {
+    printf("%-28s %-22s %10s %14s %12s %8s\n", "parser", "corpus", "MB/s", "commands/s", "allocs/cmd",
+           "errors");
+    for (const BenchmarkResult& result : results) {
+        printf("%-28s %-22s %10.1f %14.0f %12.2f %8zu\n", result.parser, result.corpus,
+               result.bytes / result.seconds / 1e6, result.commands / result.seconds,
+               result.allocationsPerCommand, result.errorsPerPass);
+    }
+}
+
+static void printJson(const vector<BenchmarkResult>& results) {
+#if defined(__AVX2__)
+    const char* kernel = "AVX2";
+#elif defined(__SSE2__)
+    const char* kernel = "SSE2";
+#else
+    const char* kernel = "scalar";
+#endif
+    printf("{\n  \"kernel\": \"%s\",\n  \"framesPerCorpus\": %zu,\n  \"results\": [\n", kernel, FRAMES_PER_CORPUS);
+    for (size_t t = 0; t < results.size(); t++) {
+        const BenchmarkResult& result = results[t];
+        printf("    {\"parser\": \"%s\", \"corpus\": \"%s\", \"commands\": %zu, \"bytes\": %zu, "
+               "\"mbPerSecond\": %.3f, \"commandsPerSecond\": %.1f, \"allocationsPerCommand\": %.4f, "
+               "\"errorsPerPass\": %zu}%s\n", result.parser, result.corpus, result.commands, result.bytes,
+               result.bytes / result.seconds / 1e6, result.commands / result.seconds,
+               result.allocationsPerCommand, result.errorsPerPass, t + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+void benchmarkParsers(bool json) {
+    vector<BenchmarkResult> results;
+    for (const CorpusDefinition& definition : CORPORA) {
+        Corpus corpus;
+        generateCorpus(&definition, corpus);
+
+        results.push_back(measure("InParser::parse(view)", corpus, [&]() { return passInParserView(corpus); }));
+        results.push_back(measure("InParser::parse(shared_ptr)", corpus,
+            [&]() { return passInParserShared(corpus); }));
+        if (definition.miniCompatible == true) {
+            results.push_back(measure("miniInParseBuffer", corpus, [&]() { return passMiniInParseBuffer(corpus); }));
+            results.push_back(measure("miniInParse(char)", corpus, [&]() { return passMiniInParseChar(corpus); }));
+        }
+        if (definition.generator != nullptr) {
+            results.push_back(measure("RemoteCommandBuilder(string)", corpus,
+                [&]() { return passBuilderString(corpus); }));
+            results.push_back(measure("RemoteCommandBuilder(buffer)", corpus,
+                [&]() { return passBuilderBuffer(corpus); }));
+        }
+    }
+
+    if (json == true) {
+        printJson(results);
+    } else {
+        printText(results);
+    }
+}
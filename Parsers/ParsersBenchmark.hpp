@@ -0,0 +1,16 @@
+/*
+ * ParsersBenchmark.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Zarnowski
+ */
+
+#ifndef ParsersBenchmark_hpp
+#define ParsersBenchmark_hpp
+
+//Measures MB/s, commands/s and allocations per command of InParser, MiniInParser and
+//RemoteCommandBuilder on generated corpora. With json results are printed as one JSON document,
+//so they can be stored and compared between releases.
+void benchmarkParsers(bool json);
+
+#endif /* ParsersBenchmark_hpp */
@@ -7,20 +7,76 @@
 
 #include "RemoteCommandBuilder.h"
 #include <stdexcept>
-#include <iomanip>
-#include <sstream>
+#include <charconv>
+#include <string.h>
 
-RemoteCommandBuilder::RemoteCommandBuilder(const string& cmd)
-: outCmd(cmd), elementsType(UNKNOWN), isSequenceOpen(false), needComa(false), expectedNextSubsequence(false) {
-    for (auto c = outCmd.begin() ; c < outCmd.end(); c++) {
+//sign, 309 digits of DBL_MAX, '.' and 3 digits of fraction
+static const size_t MAX_DOUBLE_CHARS = 320;
+static const size_t MAX_INT64_CHARS = 20;
+
+RemoteCommandBuilder::RemoteCommandBuilder(string_view cmd)
+: outCmd(cmd), buffer(nullptr), bufferSize(0), bufferUsed(0), elementsType(UNKNOWN), isSequenceOpen(false),
+  needComa(false), expectedNextSubsequence(false) {
+    validateCmd(cmd);
+}
+
+RemoteCommandBuilder::RemoteCommandBuilder(string_view cmd, char* buffer, size_t bufferSize)
+: buffer(buffer), bufferSize(bufferSize), bufferUsed(0), elementsType(UNKNOWN), isSequenceOpen(false),
+  needComa(false), expectedNextSubsequence(false) {
+    validateCmd(cmd);
+    append(cmd.data(), cmd.size());
+}
+
+RemoteCommandBuilder::RemoteCommandBuilder(CommandId cmd)
+: buffer(nullptr), bufferSize(0), bufferUsed(0), elementsType(UNKNOWN), isSequenceOpen(false),
+  needComa(false), expectedNextSubsequence(false) {
+    validateCmd(cmd);
+    const char name[3] = {cmd.charAt(0), cmd.charAt(1), cmd.charAt(2)};
+    outCmd.assign(name, sizeof(name));
+}
+
+RemoteCommandBuilder::RemoteCommandBuilder(CommandId cmd, char* buffer, size_t bufferSize)
+: buffer(buffer), bufferSize(bufferSize), bufferUsed(0), elementsType(UNKNOWN), isSequenceOpen(false),
+  needComa(false), expectedNextSubsequence(false) {
+    validateCmd(cmd);
+    const char name[3] = {cmd.charAt(0), cmd.charAt(1), cmd.charAt(2)};
+    append(name, sizeof(name));
+}
+
+void RemoteCommandBuilder::validateCmd(CommandId cmd) {
+    //ids from literals are checked at compile time, this catches default constructed ones
+    if (cmd.isValid() == false) {
+        throw invalid_argument("Only capital letters allowed!");
+    }
+}
+
+void RemoteCommandBuilder::validateCmd(string_view cmd) {
+    for (auto c = cmd.begin() ; c < cmd.end(); c++) {
         if (*c < 'A' || *c > 'Z') {
             throw invalid_argument("Only capital letters allowed!");
         }
     }
-    if (outCmd.size() != 3) {
+    if (cmd.size() != 3) {
         throw invalid_argument("Cmd must be exactly 3 chars long!");
     }
 }
+
+void RemoteCommandBuilder::append(const char* data, size_t length) {
+    if (buffer == nullptr) {
+        outCmd.append(data, length);
+        return;
+    }
+    if (bufferUsed + length > bufferSize) {
+        throw length_error("Buffer too small for command!");
+    }
+    memcpy(buffer + bufferUsed, data, length);
+    bufferUsed += length;
+}
+
+void RemoteCommandBuilder::append(char c) {
+    append(&c, 1);
+}
+
 void RemoteCommandBuilder::addArgument(int value) {
     addArgument((int64_t)value);
 }
@@ -33,9 +89,11 @@ void RemoteCommandBuilder::addArgument(int64_t value) {
     }
     elementsType = DIGIT;
     if (needComa == true) {
-        outCmd += ',';
+        append(',');
     }
-    outCmd += to_string(value);
+    char tmp[MAX_INT64_CHARS];
+    to_chars_result result = to_chars(tmp, tmp + sizeof(tmp), value);
+    append(tmp, result.ptr - tmp);
     needComa = true;
 }
 
@@ -48,15 +106,16 @@ void RemoteCommandBuilder::addArgument(double value) {
     }
     elementsType = DIGIT;
     if (needComa == true) {
-        outCmd += ',';
+        append(',');
     }
-    stringstream str;
-    str << fixed << setprecision( 3 ) << value;
-    outCmd += str.str();
+    //same output as stream with fixed and setprecision(3)
+    char tmp[MAX_DOUBLE_CHARS];
+    to_chars_result result = to_chars(tmp, tmp + sizeof(tmp), value, chars_format::fixed, 3);
+    append(tmp, result.ptr - tmp);
     needComa = true;
 }
 
-void RemoteCommandBuilder::addArgument(const string& value) {
+void RemoteCommandBuilder::addArgument(string_view value) {
     if (elementsType == DIGIT) {
         throw invalid_argument("String expected, no mixed sequences are allowed!");
     }
@@ -65,11 +124,11 @@ void RemoteCommandBuilder::addArgument(const string& value) {
     }
     elementsType = STRING;
     if (needComa == true) {
-        outCmd += ',';
+        append(',');
     }
-    outCmd += '"';
-    outCmd += value;
-    outCmd += '"';
+    append('"');
+    append(value.data(), value.size());
+    append('"');
     needComa = true;
 }
 
@@ -78,7 +137,7 @@ void RemoteCommandBuilder::startSequence() {
         throw invalid_argument("No nested sequences allowed!");
     }
     isSequenceOpen = true;
-    outCmd += "(";
+    append('(');
     needComa = false;
     expectedNextSubsequence = false;
 }
@@ -91,12 +150,15 @@ void RemoteCommandBuilder::endSequence() {
         throw invalid_argument("At least one element in sequence is required!");
     }
     isSequenceOpen = false;
-    outCmd += ")";
+    append(')');
     needComa = false;
     expectedNextSubsequence = true;
 }
 
 string RemoteCommandBuilder::buildCommand() {
+    if (buffer != nullptr) {
+        return string(buildFrame());
+    }
     if (isSequenceOpen == true) {
         throw invalid_argument("Last sequence is still open, call endSequence()!");
     }
@@ -104,3 +166,18 @@ string RemoteCommandBuilder::buildCommand() {
     tmp += "\r";
     return tmp;
 }
+
+string_view RemoteCommandBuilder::buildFrame() {
+    if (buffer == nullptr) {
+        throw invalid_argument("buildFrame() requires buffer, use buildCommand()!");
+    }
+    if (isSequenceOpen == true) {
+        throw invalid_argument("Last sequence is still open, call endSequence()!");
+    }
+    if (bufferUsed + 1 > bufferSize) {
+        throw length_error("Buffer too small for command!");
+    }
+    //'\r' is not counted as used, so more arguments can still be added
+    buffer[bufferUsed] = '\r';
+    return string_view(buffer, bufferUsed + 1);
+}
@@ -9,27 +9,45 @@
 #define RemoteCommandBuilder_hpp
 
 #include <string>
+#include <string_view>
+#include "CommandId.hpp"
 
 using namespace std;
 
 class RemoteCommandBuilder {
     public:
-        RemoteCommandBuilder(const string& cmd);
+        RemoteCommandBuilder(string_view cmd);
+        //Frame is serialized directly into buffer, builder doesn't allocate. Throws length_error
+        //if buffer is too small.
+        RemoteCommandBuilder(string_view cmd, char* buffer, size_t bufferSize);
+        //ids made from literals are validated when they are built, only "no command" id is rejected here
+        RemoteCommandBuilder(CommandId cmd);
+        RemoteCommandBuilder(CommandId cmd, char* buffer, size_t bufferSize);
 
         void addArgument(int64_t value);
         void addArgument(int value);
         void addArgument(double value);
-        void addArgument(const string& value);
+        void addArgument(string_view value);
         void startSequence();
         void endSequence();
 
         string buildCommand();
+        //Only for buffer mode, returned view points into buffer and includes ending '\r'
+        string_view buildFrame();
     private:
         string outCmd;
+        char* buffer;
+        size_t bufferSize;
+        size_t bufferUsed;
         enum ElementType {UNKNOWN, DIGIT, STRING} elementsType;
         bool isSequenceOpen;
         bool needComa;
         bool expectedNextSubsequence;
+
+        void validateCmd(string_view cmd);
+        void validateCmd(CommandId cmd);
+        void append(const char* data, size_t length);
+        void append(char c);
 };
 
 #endif /* RemoteCommandBuilder_hpp */
@@ -7,6 +7,7 @@
 
 #include "RemoteCommandBuilderTests.hpp"
 #include "RemoteCommandBuilder.h"
+#include <stdexcept>
 
 static bool successScenarios() {
 
@@ -143,11 +144,115 @@ static bool failureScenarios() {
     return true;
 }
 
+static bool bufferScenarios() {
+    char buf[64];
+
+    RemoteCommandBuilder r1("PWD", buf, sizeof(buf));
+    if ("PWD\r" != r1.buildFrame()) {
+        return false;
+    }
+
+    RemoteCommandBuilder r2("PWD", buf, sizeof(buf));
+    r2.addArgument(INT64_MIN);
+    r2.addArgument(-2.2346);
+    r2.addArgument(0.0);
+    if ("PWD-9223372036854775808,-2.235,0.000\r" != r2.buildFrame()) {
+        return false;
+    }
+
+    RemoteCommandBuilder r3("PWD", buf, sizeof(buf));
+    r3.startSequence();
+    r3.addArgument("test");
+    r3.endSequence();
+    //frame can be taken and builder can still be extended
+    if ("PWD(\"test\")\r" != r3.buildFrame()) {
+        return false;
+    }
+    r3.startSequence();
+    r3.addArgument("jka");
+    r3.endSequence();
+    if ("PWD(\"test\")(\"jka\")\r" != r3.buildFrame() || r3.buildFrame().data() != buf) {
+        return false;
+    }
+
+    //exactly fits, including '\r'
+    char small[7];
+    RemoteCommandBuilder r4("PWD", small, sizeof(small));
+    r4.addArgument(123);
+    if ("PWD123\r" != r4.buildFrame()) {
+        return false;
+    }
+
+    try {
+        r4.addArgument(4);
+        r4.buildFrame();
+        return false;
+    } catch (length_error&) {
+        //expected
+    }
+
+    try {
+        RemoteCommandBuilder r("PWD", buf, sizeof(buf));
+        r.startSequence();
+        r.addArgument(2);
+        r.endSequence();
+        r.addArgument(6);
+        return false;
+    } catch (invalid_argument&) {
+        //expected
+    }
+
+    try {
+        RemoteCommandBuilder r("PWD");
+        r.buildFrame();
+        return false;
+    } catch (invalid_argument&) {
+        //expected
+    }
+
+    return true;
+}
+
+static bool commandIdScenarios() {
+    char buf[16];
+
+    RemoteCommandBuilder r1(COMMAND_ID("PWD"));
+    r1.addArgument(1);
+    if ("PWD1\r" != r1.buildCommand()) {
+        return false;
+    }
+
+    constexpr CommandId setCmd("SET");
+    RemoteCommandBuilder r2(setCmd, buf, sizeof(buf));
+    r2.addArgument("a");
+    if ("SET\"a\"\r" != r2.buildFrame()) {
+        return false;
+    }
+
+    //"no command" id would put NUL bytes into frame
+    try {
+        RemoteCommandBuilder r3{CommandId()};
+        return false;
+    } catch (invalid_argument&) {
+        //expected
+    }
+    try {
+        RemoteCommandBuilder r4(CommandId::fromPacked(0x41000000), buf, sizeof(buf));
+        return false;
+    } catch (invalid_argument&) {
+        //expected
+    }
+
+    return true;
+}
+
 bool testRemoteCommandBuilder() {
     bool testResult = true;
 
     testResult &= successScenarios();
     testResult &= failureScenarios();
+    testResult &= bufferScenarios();
+    testResult &= commandIdScenarios();
 
-    return true;
+    return testResult;
 }
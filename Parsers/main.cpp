@@ -10,6 +10,7 @@
 #include "MiniInParserTests.h"
 #include "InParserTests.hpp"
 #include "RemoteCommandBuilderTests.hpp"
+#include "CharScannerTests.hpp"
 
 int main(int argc, const char * argv[]) {
     if (testMiniInParser() == true) {
@@ -27,5 +28,10 @@ int main(int argc, const char * argv[]) {
     } else {
         printf("RemoteCommandBuilder: FAILURE\n");
     }
+    if (testCharScanner() == true) {
+        printf("CharScanner: SUCCESS\n");
+    } else {
+        printf("CharScanner: FAILURE\n");
+    }
     return 0;
 }